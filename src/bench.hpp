@@ -0,0 +1,23 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A named microbenchmark. run performs operations operations and returns the time they took, leaving any setup out
+struct Benchmark
+{
+    std::string name{};
+    std::uint64_t operations{};
+    std::function<std::chrono::nanoseconds()> run{};
+};
+
+#ifdef CHIP8_BENCH_GUI
+// Adds the benchmarks that need Qt, rendering and tone generation
+void add_gui_benchmarks(std::vector<Benchmark> &benchmarks);
+#endif
+
+#endif  // BENCH_HPP
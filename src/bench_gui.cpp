@@ -0,0 +1,155 @@
+#include <QApplication>
+#include <QAudioFormat>
+#include <QImage>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.hpp"
+#include "emulator_thread.hpp"
+#include "emulator_utils.hpp"
+#include "qt_utils.hpp"
+#include "tone_generator.hpp"
+
+namespace
+{
+// Widgets need an application, created on first use and kept for the whole run. Renders offscreen unless a platform
+// was asked for explicitly
+void ensure_application()
+{
+    static int argc{1};
+    static char name[]{"chip8_bench"};
+    static char *argv[]{name, nullptr};
+
+    if (QApplication::instance() == nullptr)
+    {
+        if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+        static QApplication application(argc, argv);
+    }
+}
+
+// Silences std::cout while alive, so the widget's status messages don't end up between the results
+class QuietOutput
+{
+public:
+    QuietOutput() :
+        previous(std::cout.rdbuf(nullptr))
+    {
+    }
+
+    ~QuietOutput()
+    {
+        std::cout.rdbuf(previous);
+    }
+
+    QuietOutput(const QuietOutput &) = delete;
+    QuietOutput &operator=(const QuietOutput &) = delete;
+
+private:
+    std::streambuf *previous;
+};
+
+void add_paint_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    for (const std::uint32_t window_scale : {4u, 8u, 16u, 32u})
+    {
+        benchmarks.push_back({"paint/scale" + std::to_string(window_scale),
+                              1000,
+                              [window_scale]()
+                              {
+                                  ensure_application();
+                                  const QuietOutput quiet_output{};
+
+                                  // An idle loop, the emulator thread runs while the widget exists
+                                  Chip8 chip8{};
+                                  load_font(chip8);
+                                  chip8.memory[START_ADDRESS] = 0x12;
+                                  chip8.memory[START_ADDRESS + 1] = 0x00;
+                                  ExecutionOptions execution_options{};
+                                  execution_options.mute = true;
+                                  Chip8EmulatorWidget widget(chip8, execution_options, 700, window_scale);
+
+                                  // Every render repaints the whole widget through paintEvent
+                                  QImage surface(widget.size(), QImage::Format_RGB32);
+                                  const auto start{std::chrono::steady_clock::now()};
+                                  for (std::uint32_t i{0}; i < 1000; i++)
+                                  {
+                                      widget.render(&surface);
+                                  }
+                                  const auto elapsed{std::chrono::steady_clock::now() - start};
+
+                                  return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+                              }});
+    }
+}
+
+void add_tone_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    struct SampleFormat
+    {
+        const char *name;
+        QAudioFormat::SampleFormat format;
+    };
+
+    const SampleFormat sample_formats[]{{"uint8", QAudioFormat::UInt8},
+                                        {"int16", QAudioFormat::Int16},
+                                        {"int32", QAudioFormat::Int32},
+                                        {"float", QAudioFormat::Float}};
+
+    for (const SampleFormat &sample_format : sample_formats)
+    {
+        // Operations are stereo 48kHz frames, generated while the beep is playing
+        benchmarks.push_back({std::string("tone/") + sample_format.name,
+                              480000,
+                              [sample_format]()
+                              {
+                                  // Keeps reloading the sound timer, so the tone never stops
+                                  Chip8 chip8{};
+                                  chip8.memory[START_ADDRESS] = 0x60;
+                                  chip8.memory[START_ADDRESS + 1] = 0xFF;
+                                  chip8.memory[START_ADDRESS + 2] = 0xF0;
+                                  chip8.memory[START_ADDRESS + 3] = 0x18;
+                                  chip8.memory[START_ADDRESS + 4] = 0x12;
+                                  chip8.memory[START_ADDRESS + 5] = 0x02;
+                                  chip8.pc = START_ADDRESS;
+
+                                  EmulatorThread emulator(chip8, ExecutionOptions{}, 700);
+                                  emulator.start();
+                                  while (!emulator.sound_on())
+                                  {
+                                      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                                  }
+
+                                  QAudioFormat format{};
+                                  format.setSampleRate(48000);
+                                  format.setChannelCount(2);
+                                  format.setSampleFormat(sample_format.format);
+
+                                  ToneGenerator generator(emulator, format);
+                                  generator.open(QIODevice::ReadOnly);
+                                  std::vector<char> buffer(static_cast<std::size_t>(format.bytesForFrames(4800)));
+
+                                  const auto start{std::chrono::steady_clock::now()};
+                                  for (std::uint32_t i{0}; i < 100; i++)
+                                  {
+                                      generator.read(buffer.data(), static_cast<qint64>(buffer.size()));
+                                  }
+                                  const auto elapsed{std::chrono::steady_clock::now() - start};
+
+                                  emulator.stop();
+                                  return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+                              }});
+    }
+}
+}  // namespace
+
+void add_gui_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    add_paint_benchmarks(benchmarks);
+    add_tone_benchmarks(benchmarks);
+}
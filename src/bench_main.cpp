@@ -0,0 +1,527 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "emulator_utils.hpp"
+#include "instructions.hpp"
+#include "opcode_table.hpp"
+
+namespace
+{
+const std::string BENCH_USAGE{
+    "Usage: /path/to/chip8_bench --filter <string>(optional) --repetitions <int>(optional, default 5) "
+    "--output /path/to/results.csv(optional) --list(optional)"};
+
+// Fixed seed for every generated input, so runs on different commits measure the same work
+const std::uint64_t BENCH_SEED{1};
+
+struct BenchOptions
+{
+    std::string filter{};
+    std::uint32_t repetitions{5};
+    std::string output_location{};
+    bool list{false};
+};
+
+// A synthetic ROM for the macro benchmarks
+struct SyntheticRom
+{
+    const char *name;
+    std::vector<std::uint16_t> program;
+};
+
+// Written to after every benchmark, so the compiler can't drop the work as unused
+volatile std::uint64_t benchmark_sink{0};
+
+// Parses the benchmark arguments. Returns -1 on error, 0 on success, and 1 if the --help option is encountered
+int parse_bench_arguments(int argc, char *argv[], BenchOptions &options)
+{
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--help" || arg == "-h")
+        {
+            std::cout << "Runs the CHIP-8 emulator microbenchmarks.\n" << BENCH_USAGE << std::endl;
+            return 1;
+        }
+
+        if (arg == "--list")
+        {
+            options.list = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << ".\n" << BENCH_USAGE << std::endl;
+            return -1;
+        }
+
+        std::string value{argv[++i]};
+        try
+        {
+            if (arg == "--filter")
+            {
+                options.filter = value;
+            }
+            else if (arg == "--repetitions")
+            {
+                options.repetitions = static_cast<std::uint32_t>(std::stoul(value));
+            }
+            else if (arg == "--output")
+            {
+                options.output_location = value;
+            }
+            else
+            {
+                std::cerr << "Unknown argument: " << arg << ".\n" << BENCH_USAGE << std::endl;
+                return -1;
+            }
+        }
+        catch (std::logic_error &)
+        {
+            std::cerr << "Invalid " << arg << " argument.\n" << BENCH_USAGE << std::endl;
+            return -1;
+        }
+    }
+
+    if (options.repetitions == 0)
+    {
+        std::cerr << "Invalid --repetitions argument.\n" << BENCH_USAGE << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+// A machine with the font loaded and the random numbers seeded, ready to run from the start address
+Chip8 make_machine(const bool cosmac = false)
+{
+    Chip8 chip8{};
+    chip8.cosmac = cosmac;
+    load_font(chip8);
+    chip8.random.seed(BENCH_SEED);
+    chip8.pc = START_ADDRESS;
+
+    return chip8;
+}
+
+void load_program(Chip8 &chip8, const std::vector<std::uint16_t> &program)
+{
+    for (std::size_t i{0}; i < program.size(); i++)
+    {
+        chip8.memory[START_ADDRESS + 2 * i] = static_cast<std::uint8_t>(program[i] >> 8);
+        chip8.memory[START_ADDRESS + 2 * i + 1] = static_cast<std::uint8_t>(program[i] & 0xFF);
+    }
+}
+
+std::uint64_t display_checksum(const Chip8 &chip8)
+{
+    std::uint64_t checksum{0};
+    for (const std::uint64_t row : chip8.display)
+    {
+        checksum ^= row;
+    }
+
+    return checksum;
+}
+
+// Opcodes that execute() can run in any order without a program around them: no subroutines, no stack, and the index
+// register kept low so memory accesses through it stay in bounds
+std::vector<std::uint16_t> make_opcode_mix(const bool alu_only)
+{
+    const std::uint16_t alu_templates[]{0x6000, 0x7000, 0x8000, 0x8001, 0x8002, 0x8003, 0x8004,
+                                        0x8005, 0x8006, 0x8007, 0x800E, 0x3000, 0x4000, 0x5000, 0x9000};
+    const std::uint16_t mixed_templates[]{0x00E0, 0x1000, 0x3000, 0x4000, 0x5000, 0x6000, 0x7000, 0x8000, 0x8001,
+                                          0x8002, 0x8003, 0x8004, 0x8005, 0x8006, 0x8007, 0x800E, 0x9000, 0xA000,
+                                          0xB000, 0xC000, 0xD000, 0xE09E, 0xE0A1, 0xF007, 0xF015, 0xF018, 0xF029,
+                                          0xF033, 0xF055, 0xF065, 0x6000, 0x7000, 0x8004, 0xA000};
+
+    std::mt19937_64 generator(BENCH_SEED);
+    std::vector<std::uint16_t> opcodes(4096);
+
+    for (std::uint16_t &opcode : opcodes)
+    {
+        const std::uint16_t base{alu_only ? alu_templates[generator() % std::size(alu_templates)]
+                                          : mixed_templates[generator() % std::size(mixed_templates)]};
+        const std::uint16_t x{static_cast<std::uint16_t>((generator() % 16) << 8)};
+        const std::uint16_t y{static_cast<std::uint16_t>((generator() % 16) << 4)};
+
+        switch (base >> 12)
+        {
+            case 0x0:
+                opcode = base;
+                break;
+            case 0x1:
+            case 0xB:
+                opcode = static_cast<std::uint16_t>(base | (START_ADDRESS + generator() % 0x100 * 2));
+                break;
+            case 0xA:
+                opcode = static_cast<std::uint16_t>(base | (0x300 + generator() % 0x100));
+                break;
+            case 0x5:
+            case 0x8:
+            case 0x9:
+                opcode = static_cast<std::uint16_t>(base | x | y);
+                break;
+            case 0xD:
+                opcode = static_cast<std::uint16_t>(base | x | y | (1 + generator() % 15));
+                break;
+            case 0xE:
+            case 0xF:
+                opcode = static_cast<std::uint16_t>(base | x);
+                break;
+            default:
+                opcode = static_cast<std::uint16_t>(base | x | (generator() % 256));
+                break;
+        }
+    }
+
+    return opcodes;
+}
+
+void add_execute_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    for (const bool alu_only : {true, false})
+    {
+        const std::vector<std::uint16_t> opcodes{make_opcode_mix(alu_only)};
+        benchmarks.push_back({alu_only ? "execute/alu" : "execute/mix",
+                              1000000,
+                              [opcodes]()
+                              {
+                                  Chip8 chip8{make_machine()};
+                                  const auto start{std::chrono::steady_clock::now()};
+                                  for (std::uint32_t i{0}; i < 1000000; i++)
+                                  {
+                                      chip8.pc = START_ADDRESS + 2;
+                                      execute<ModernQuirks>(chip8, opcodes[i & 4095]);
+                                  }
+                                  const auto elapsed{std::chrono::steady_clock::now() - start};
+                                  benchmark_sink = benchmark_sink + chip8.registers[0] + display_checksum(chip8);
+                                  return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+                              }});
+    }
+}
+
+// Every valid handler and how it is called with an OpcodeEntry, in OpcodeHandler order. Expanded once per dispatch
+// strategy, so the strategies only differ in how they reach the handlers
+#define BENCH_FOR_EACH_HANDLER(HANDLER)                                                                                \
+    HANDLER(Op00E0, op_00E0(chip8))                                                                                    \
+    HANDLER(Op00EE, op_00EE(chip8))                                                                                    \
+    HANDLER(Op1NNN, op_1NNN(chip8, opcode))                                                                            \
+    HANDLER(Op2NNN, op_2NNN(chip8, opcode))                                                                            \
+    HANDLER(Op3XNN, op_3XNN(chip8, opcode, entry.x))                                                                   \
+    HANDLER(Op4XNN, op_4XNN(chip8, opcode, entry.x))                                                                   \
+    HANDLER(Op5XY0, op_5XY0(chip8, entry.x, entry.y))                                                                  \
+    HANDLER(Op6XNN, op_6XNN(chip8, opcode, entry.x))                                                                   \
+    HANDLER(Op7XNN, op_7XNN(chip8, opcode, entry.x))                                                                   \
+    HANDLER(Op8XY0, op_8XY0(chip8, entry.x, entry.y))                                                                  \
+    HANDLER(Op8XY1, op_8XY1<ModernQuirks>(chip8, entry.x, entry.y))                                                    \
+    HANDLER(Op8XY2, op_8XY2<ModernQuirks>(chip8, entry.x, entry.y))                                                    \
+    HANDLER(Op8XY3, op_8XY3<ModernQuirks>(chip8, entry.x, entry.y))                                                    \
+    HANDLER(Op8XY4, op_8XY4(chip8, entry.x, entry.y))                                                                  \
+    HANDLER(Op8XY5, op_8XY5(chip8, entry.x, entry.y))                                                                  \
+    HANDLER(Op8XY6, op_8XY6<ModernQuirks>(chip8, entry.x, entry.y))                                                    \
+    HANDLER(Op8XY7, op_8XY7(chip8, entry.x, entry.y))                                                                  \
+    HANDLER(Op8XYE, op_8XYE<ModernQuirks>(chip8, entry.x, entry.y))                                                    \
+    HANDLER(Op9XY0, op_9XY0(chip8, entry.x, entry.y))                                                                  \
+    HANDLER(OpANNN, op_ANNN(chip8, opcode))                                                                            \
+    HANDLER(OpBNNN, op_BNNN<ModernQuirks>(chip8, opcode, entry.x))                                                     \
+    HANDLER(OpCXNN, op_CXNN(chip8, opcode, entry.x))                                                                   \
+    HANDLER(OpDXYN, op_DXYN<ModernQuirks>(chip8, opcode, entry.x, entry.y))                                            \
+    HANDLER(OpEX9E, op_EX9E(chip8, entry.x))                                                                           \
+    HANDLER(OpEXA1, op_EXA1(chip8, entry.x))                                                                           \
+    HANDLER(OpFX07, op_FX07(chip8, entry.x))                                                                           \
+    HANDLER(OpFX0A, op_FX0A<ModernQuirks>(chip8, entry.x))                                                             \
+    HANDLER(OpFX15, op_FX15(chip8, entry.x))                                                                           \
+    HANDLER(OpFX18, op_FX18(chip8, entry.x))                                                                           \
+    HANDLER(OpFX1E, op_FX1E<ModernQuirks>(chip8, entry.x))                                                             \
+    HANDLER(OpFX29, op_FX29(chip8, entry.x))                                                                           \
+    HANDLER(OpFX33, op_FX33(chip8, opcode, entry.x))                                                                   \
+    HANDLER(OpFX55, op_FX55<ModernQuirks>(chip8, opcode, entry.x))                                                     \
+    HANDLER(OpFX65, op_FX65<ModernQuirks>(chip8, opcode, entry.x))
+
+// Runs the opcodes through a switch on the table entry, the way execute() does
+void dispatch_switch(Chip8 &chip8, const std::vector<std::uint16_t> &opcodes, const std::uint32_t count)
+{
+    for (std::uint32_t i{0}; i < count; i++)
+    {
+        const std::uint16_t opcode{opcodes[i & 4095]};
+        const OpcodeEntry &entry{opcode_entry(opcode)};
+        chip8.pc = START_ADDRESS + 2;
+
+        switch (entry.handler)
+        {
+#define BENCH_SWITCH_CASE(NAME, CALL) \
+    case OpcodeHandler::NAME:         \
+        CALL;                         \
+        break;
+            BENCH_FOR_EACH_HANDLER(BENCH_SWITCH_CASE)
+#undef BENCH_SWITCH_CASE
+            case OpcodeHandler::Invalid:
+                return;
+        }
+    }
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+// Runs the opcodes through a computed goto, a GCC and Clang extension. Every handler ends in its own indirect jump to
+// the next one instead of sharing the switch's, which gives the branch predictor one history per handler
+void dispatch_goto(Chip8 &chip8, const std::vector<std::uint16_t> &opcodes, const std::uint32_t count)
+{
+    // clang-format off
+#define BENCH_GOTO_LABEL(NAME, CALL) &&label_##NAME,
+    static void *const labels[OPCODE_HANDLER_COUNT]{BENCH_FOR_EACH_HANDLER(BENCH_GOTO_LABEL) &&label_Invalid};
+#undef BENCH_GOTO_LABEL
+    // clang-format on
+
+    std::uint32_t i{0};
+    std::uint16_t opcode{};
+    OpcodeEntry entry{};
+
+#define BENCH_GOTO_NEXT()                                    \
+    if (i == count)                                          \
+    {                                                        \
+        return;                                              \
+    }                                                        \
+    opcode = opcodes[i++ & 4095];                            \
+    entry = opcode_entry(opcode);                            \
+    chip8.pc = START_ADDRESS + 2;                            \
+    goto *labels[static_cast<std::size_t>(entry.handler)];
+
+    BENCH_GOTO_NEXT();
+
+#define BENCH_GOTO_HANDLER(NAME, CALL) \
+    label_##NAME:                      \
+    CALL;                              \
+    BENCH_GOTO_NEXT();
+    BENCH_FOR_EACH_HANDLER(BENCH_GOTO_HANDLER)
+#undef BENCH_GOTO_HANDLER
+#undef BENCH_GOTO_NEXT
+
+label_Invalid:
+    return;
+}
+#pragma GCC diagnostic pop
+#endif
+
+void add_dispatch_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    struct Strategy
+    {
+        const char *name;
+        void (*dispatch)(Chip8 &, const std::vector<std::uint16_t> &, std::uint32_t);
+    };
+
+    const std::vector<Strategy> strategies{
+        {"switch", dispatch_switch},
+#if defined(__GNUC__)
+        {"goto", dispatch_goto},
+#endif
+    };
+
+    for (const bool alu_only : {true, false})
+    {
+        const std::vector<std::uint16_t> opcodes{make_opcode_mix(alu_only)};
+        for (const Strategy &strategy : strategies)
+        {
+            benchmarks.push_back({std::string("dispatch/") + strategy.name + (alu_only ? "/alu" : "/mix"),
+                                  1000000,
+                                  [opcodes, strategy]()
+                                  {
+                                      Chip8 chip8{make_machine()};
+                                      const auto start{std::chrono::steady_clock::now()};
+                                      strategy.dispatch(chip8, opcodes, 1000000);
+                                      const auto elapsed{std::chrono::steady_clock::now() - start};
+                                      benchmark_sink = benchmark_sink + chip8.registers[0] + display_checksum(chip8);
+                                      return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+                                  }});
+        }
+    }
+}
+
+void add_dxyn_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    struct Placement
+    {
+        const char *name;
+        std::uint8_t x;
+        std::uint8_t y;
+        bool cosmac;
+    };
+
+    const Placement placements[]{
+        {"aligned", 0, 0, false}, {"unaligned", 3, 4, false}, {"wrap", 60, 30, false}, {"clip", 60, 30, true}};
+
+    for (const std::uint16_t height : {1, 5, 15})
+    {
+        for (const Placement &placement : placements)
+        {
+            benchmarks.push_back({std::string("dxyn/h") + std::to_string(height) + "/" + placement.name,
+                                  1000000,
+                                  [height, placement]()
+                                  {
+                                      Chip8 chip8{make_machine(placement.cosmac)};
+                                      chip8.index_register = 0x300;
+                                      std::fill(chip8.memory.begin() + 0x300, chip8.memory.begin() + 0x310, 0xA5);
+                                      chip8.registers[0] = placement.x;
+                                      chip8.registers[1] = placement.y;
+
+                                      const std::uint16_t opcode{static_cast<std::uint16_t>(0xD010 | height)};
+                                      const auto draw{placement.cosmac ? op_DXYN<CosmacQuirks> : op_DXYN<ModernQuirks>};
+                                      const auto start{std::chrono::steady_clock::now()};
+                                      for (std::uint32_t i{0}; i < 1000000; i++)
+                                      {
+                                          draw(chip8, opcode, 0, 1);
+                                      }
+                                      const auto elapsed{std::chrono::steady_clock::now() - start};
+                                      benchmark_sink = benchmark_sink + display_checksum(chip8) + chip8.registers[0xF];
+                                      return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+                                  }});
+        }
+    }
+}
+
+void add_cxnn_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    benchmarks.push_back({"cxnn",
+                          1000000,
+                          []()
+                          {
+                              Chip8 chip8{make_machine()};
+                              std::uint64_t sum{0};
+                              const auto start{std::chrono::steady_clock::now()};
+                              for (std::uint32_t i{0}; i < 1000000; i++)
+                              {
+                                  op_CXNN(chip8, 0xC0FF, 0);
+                                  sum += chip8.registers[0];
+                              }
+                              const auto elapsed{std::chrono::steady_clock::now() - start};
+                              benchmark_sink = benchmark_sink + sum;
+                              return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+                          }});
+}
+
+// Small programs that loop forever, each stressing a different part of the engines
+std::vector<SyntheticRom> synthetic_roms()
+{
+    return {
+        // Register arithmetic in a tight loop
+        {"alu", {0x6001, 0x6102, 0x8014, 0x8105, 0x8203, 0x7301, 0x8236, 0x3300, 0x1204, 0x1200}},
+        // Fills the screen with sprites row by row, then clears it
+        {"sprites",
+         {0xA050, 0x6000, 0x6100, 0xD015, 0x7008, 0x3040, 0x1206, 0x6000, 0x7106, 0x311E, 0x1206, 0x00E0, 0x1202}},
+        // Nested subroutine calls
+        {"calls", {0x2206, 0x7001, 0x1200, 0x220A, 0x00EE, 0x8014, 0x00EE}},
+        // Rewrites one of its own instructions on every iteration
+        {"smc", {0x6071, 0x6101, 0xA20C, 0xF155, 0x7201, 0x7301, 0x0000, 0x1200}},
+    };
+}
+
+void add_macro_benchmarks(std::vector<Benchmark> &benchmarks)
+{
+    for (const SyntheticRom &rom : synthetic_roms())
+    {
+        for (const Engine engine : {Engine::Switch, Engine::Cached, Engine::Block, Engine::Jit})
+        {
+            const std::vector<std::uint16_t> program{rom.program};
+            benchmarks.push_back({std::string("rom/") + rom.name + "/" + engine_name(engine),
+                                  1000000,
+                                  [program, engine]()
+                                  {
+                                      Chip8 chip8{make_machine()};
+                                      load_program(chip8, program);
+                                      Interpreter interpreter(chip8, engine);
+
+                                      const auto start{std::chrono::steady_clock::now()};
+                                      const bool success{interpreter.run(1000000)};
+                                      const auto elapsed{std::chrono::steady_clock::now() - start};
+
+                                      if (!success)
+                                      {
+                                          std::cerr << "Synthetic ROM stopped early." << std::endl;
+                                      }
+                                      benchmark_sink = benchmark_sink + display_checksum(chip8) + chip8.registers[0];
+                                      return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+                                  }});
+        }
+    }
+}
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options{};
+
+    switch (parse_bench_arguments(argc, argv, options))
+    {
+        case -1:
+            std::cerr << "Fatal error, execution aborted." << std::endl;
+            return EXIT_FAILURE;
+        case 1:
+            return EXIT_SUCCESS;
+        default:
+            break;
+    }
+
+    std::vector<Benchmark> benchmarks{};
+    add_execute_benchmarks(benchmarks);
+    add_dispatch_benchmarks(benchmarks);
+    add_dxyn_benchmarks(benchmarks);
+    add_cxnn_benchmarks(benchmarks);
+    add_macro_benchmarks(benchmarks);
+#ifdef CHIP8_BENCH_GUI
+    add_gui_benchmarks(benchmarks);
+#endif
+
+    std::ofstream output_file{};
+    if (!options.output_location.empty())
+    {
+        output_file.open(options.output_location);
+        if (!output_file)
+        {
+            std::cerr << "Failed to create the file. Path: " << options.output_location << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream &output{options.output_location.empty() ? std::cout : output_file};
+
+    // One line per benchmark in a fixed order, with the fastest repetition, so results diff cleanly between commits
+    if (!options.list)
+    {
+        output << "benchmark,operations,ns_per_operation\n";
+    }
+
+    for (const Benchmark &benchmark : benchmarks)
+    {
+        if (benchmark.name.find(options.filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        if (options.list)
+        {
+            output << benchmark.name << "\n";
+            continue;
+        }
+
+        std::chrono::nanoseconds best{std::chrono::nanoseconds::max()};
+        for (std::uint32_t repetition{0}; repetition < options.repetitions; repetition++)
+        {
+            best = std::min(best, benchmark.run());
+        }
+
+        output << benchmark.name << ',' << benchmark.operations << ',' << std::fixed << std::setprecision(3)
+               << static_cast<double>(best.count()) / static_cast<double>(benchmark.operations) << std::endl;
+    }
+
+    return static_cast<bool>(output) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
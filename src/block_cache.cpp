@@ -0,0 +1,298 @@
+#include "block_cache.hpp"
+
+#include <algorithm>
+
+#include "emulator_utils.hpp"
+#include "instructions.hpp"
+
+namespace
+{
+const std::uint32_t MEMORY_SIZE{4096};
+
+// Returns whether the instruction neither reads nor writes the program counter, nor accesses memory past the index
+// register, so it can run inside a block body without being able to fault. Invalid opcodes are not straight-line,
+// leaving the fault to the block terminator
+bool is_straight_line(const std::uint16_t opcode)
+{
+    switch (opcode >> 12)
+    {
+        case 0x0:
+            return opcode == 0x00E0;
+
+        case 0x6:
+        case 0x7:
+        case 0xA:
+        case 0xC:
+            return true;
+
+        case 0x8:
+            switch (opcode & 0xF)
+            {
+                case 0x0:
+                case 0x1:
+                case 0x2:
+                case 0x3:
+                case 0x4:
+                case 0x5:
+                case 0x6:
+                case 0x7:
+                case 0xE:
+                    return true;
+                default:
+                    return false;
+            }
+
+        case 0xF:
+            switch (opcode & 0xFF)
+            {
+                case 0x07:
+                case 0x15:
+                case 0x18:
+                case 0x1E:
+                case 0x29:
+                    return true;
+                default:
+                    return false;
+            }
+
+        default:
+            return false;
+    }
+}
+
+// Returns whether the opcode is FX07 or FX0A, the instructions at_frame_wait() looks for
+bool is_wait(const std::uint16_t opcode)
+{
+    return (opcode & 0xF0FF) == 0xF007 || (opcode & 0xF0FF) == 0xF00A;
+}
+
+std::uint8_t nibble_x(const std::uint16_t opcode)
+{
+    return (opcode >> 8) & 0xF;
+}
+
+std::uint8_t nibble_y(const std::uint16_t opcode)
+{
+    return (opcode >> 4) & 0xF;
+}
+
+// Fused pairs, both halves keep the exact op_* semantics
+bool fused_6XNN_6XNN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_6XNN(chip8, instruction.opcode, instruction.x);
+    op_6XNN(chip8, instruction.fused_opcode, nibble_x(instruction.fused_opcode));
+    return true;
+}
+
+bool fused_7XNN_3XNN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_7XNN(chip8, instruction.opcode, instruction.x);
+    op_3XNN(chip8, instruction.fused_opcode, nibble_x(instruction.fused_opcode));
+    return true;
+}
+
+template <typename Quirks>
+bool fused_ANNN_DXYN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_ANNN(chip8, instruction.opcode);
+    op_DXYN<Quirks>(chip8,
+                    instruction.fused_opcode,
+                    nibble_x(instruction.fused_opcode),
+                    nibble_y(instruction.fused_opcode));
+    return chip8.fault.kind == FaultKind::None;
+}
+
+// Returns the handler fusing the two opcodes, or nullptr if the pair isn't fusable
+template <typename Quirks>
+bool (*fused_handler(const std::uint16_t first, const std::uint16_t second))(Chip8 &, const DecodedInstruction &)
+{
+    switch (first & 0xF000)
+    {
+        case 0x6000:
+            return (second & 0xF000) == 0x6000 ? fused_6XNN_6XNN : nullptr;
+        case 0x7000:
+            return (second & 0xF000) == 0x3000 ? fused_7XNN_3XNN : nullptr;
+        case 0xA000:
+            return (second & 0xF000) == 0xD000 ? fused_ANNN_DXYN<Quirks> : nullptr;
+        default:
+            return nullptr;
+    }
+}
+}  // namespace
+
+BlockCache::BlockCache()
+{
+    flush();
+}
+
+template <typename Quirks>
+bool BlockCache::run(Chip8 &chip8, const std::uint64_t count, const bool stop_at_frame_wait, std::uint64_t &executed)
+{
+    executed = 0;
+
+    while (executed < count)
+    {
+        if (stop_at_frame_wait && at_frame_wait(chip8))
+        {
+            return true;
+        }
+
+        // The last memory byte can't hold a full opcode, leave the fetch error to the switch decoder
+        if (chip8.pc >= MEMORY_SIZE - 1)
+        {
+            if (!step<Quirks>(chip8))
+            {
+                return false;
+            }
+            executed++;
+            continue;
+        }
+
+        std::int32_t index{block_at[chip8.pc]};
+        if (index < 0)
+        {
+            index = translate<Quirks>(chip8, chip8.pc);
+        }
+
+        const Block &block{blocks[index]};
+        if (block.instruction_count > count - executed)
+        {
+            if (!step<Quirks>(chip8))
+            {
+                return false;
+            }
+            executed++;
+            continue;
+        }
+
+        const DecodedInstruction *op{ops.data() + block.first_op};
+        const DecodedInstruction *const body_end{op + block.body_ops};
+        for (; op != body_end; ++op)
+        {
+            op->handler(chip8, *op);
+        }
+
+        // The block may be flushed by its terminator, so nothing can reference it past this point
+        const std::uint32_t instruction_count{block.instruction_count};
+        chip8.pc = block.end;
+
+        if (block.has_terminator)
+        {
+            const bool success{op->write_length == 0 ? op->handler(chip8, *op) : execute_write(chip8, *op)};
+            if (!success)
+            {
+                // Only the faulting instruction wasn't executed, the first half of a fused pair can't fault
+                executed += instruction_count - 1;
+                return false;
+            }
+        }
+
+        executed += instruction_count;
+    }
+
+    return true;
+}
+
+void BlockCache::flush()
+{
+    blocks.clear();
+    ops.clear();
+    block_at.fill(-1);
+    code_map.fill(false);
+}
+
+template <typename Quirks>
+std::int32_t BlockCache::translate(const Chip8 &chip8, const std::uint16_t address)
+{
+    Block block{};
+    block.first_op = static_cast<std::uint32_t>(ops.size());
+
+    std::uint32_t current{address};
+    while (block.instruction_count < MAX_BLOCK_INSTRUCTIONS && current + 1 < MEMORY_SIZE)
+    {
+        const std::uint16_t opcode{static_cast<std::uint16_t>(chip8.memory[current] << 8 | chip8.memory[current + 1])};
+
+        // FX07 and FX0A always start a block, so run() can stop in front of them
+        if (block.instruction_count > 0 && is_wait(opcode))
+        {
+            break;
+        }
+
+        DecodedInstruction instruction{DecodeCache::decode<Quirks>(opcode)};
+        std::uint32_t length{1};
+
+        // Try to fuse with the following instruction
+        if (current + 3 < MEMORY_SIZE && block.instruction_count + 2 <= MAX_BLOCK_INSTRUCTIONS)
+        {
+            const std::uint16_t next_opcode{
+                static_cast<std::uint16_t>(chip8.memory[current + 2] << 8 | chip8.memory[current + 3])};
+            const auto handler{fused_handler<Quirks>(opcode, next_opcode)};
+            if (handler)
+            {
+                instruction.handler = handler;
+                instruction.fused_opcode = next_opcode;
+                length = 2;
+            }
+        }
+
+        ops.push_back(instruction);
+        current += 2 * length;
+        block.instruction_count += length;
+
+        // Only 6XNN pairs stay straight-line once fused, the others end with a skip or a draw
+        const std::uint16_t last_opcode{length == 2 ? instruction.fused_opcode : opcode};
+        if (!is_straight_line(last_opcode))
+        {
+            block.has_terminator = true;
+            break;
+        }
+        block.body_ops++;
+    }
+
+    block.end = static_cast<std::uint16_t>(current);
+
+    std::fill(code_map.begin() + address, code_map.begin() + current, true);
+
+    blocks.push_back(block);
+    block_at[address] = static_cast<std::int32_t>(blocks.size() - 1);
+    return block_at[address];
+}
+
+template <typename Quirks>
+bool BlockCache::step(Chip8 &chip8)
+{
+    if (chip8.pc >= MEMORY_SIZE - 1)
+    {
+        return ::step<Quirks>(chip8);
+    }
+
+    const DecodedInstruction instruction{
+        DecodeCache::decode<Quirks>(chip8.memory[chip8.pc] << 8 | chip8.memory[chip8.pc + 1])};
+    chip8.pc += 2;
+
+    return instruction.write_length == 0 ? instruction.handler(chip8, instruction) : execute_write(chip8, instruction);
+}
+
+bool BlockCache::execute_write(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    const std::uint32_t address{chip8.index_register};
+    const bool success{instruction.handler(chip8, instruction)};
+
+    // On machines with wrap_memory, a write running past the end of memory continues at address 0
+    const std::uint32_t end{address + instruction.write_length};
+    const std::uint32_t last{std::min(end, MEMORY_SIZE)};
+    const std::uint32_t wrapped{end > MEMORY_SIZE ? end - MEMORY_SIZE : 0};
+    const auto is_code{[](bool code) { return code; }};
+    if ((address < last && std::any_of(code_map.begin() + address, code_map.begin() + last, is_code)) ||
+        std::any_of(code_map.begin(), code_map.begin() + wrapped, is_code))
+    {
+        flush();
+    }
+
+    return success;
+}
+
+#define INSTANTIATE_BLOCK_CACHE(Quirks)                                                                                \
+    template bool BlockCache::run<Quirks>(Chip8 &, std::uint64_t, bool, std::uint64_t &);
+
+CHIP8_FOR_EACH_QUIRK_PROFILE(INSTANTIATE_BLOCK_CACHE)
@@ -0,0 +1,66 @@
+#ifndef BLOCK_CACHE_HPP
+#define BLOCK_CACHE_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "chip8.hpp"
+#include "decode_cache.hpp"
+
+// Translates ROM code into basic blocks, straight-line runs of instructions ending at a jump, call, return, skip, DXYN,
+// FX0A or memory access through the index register, and executes each block as a unit. Common instruction pairs are
+// fused into a single operation while translating. A memory write landing on translated code flushes every block
+class BlockCache
+{
+public:
+    BlockCache();
+
+    // Executes exactly count instructions, or fewer if a fault stops execution, in which case false is returned. With
+    // stop_at_frame_wait, also stops early in front of an instruction for which at_frame_wait() holds. The number of
+    // instructions executed is stored in executed. Blocks keep the handlers of the quirk profile they were translated
+    // with, so the cache must be flushed before running with another one
+    template <typename Quirks>
+    bool run(Chip8 &chip8, std::uint64_t count, bool stop_at_frame_wait, std::uint64_t &executed);
+
+    // Drops every translated block, needed whenever memory is rewritten from outside the interpreter
+    void flush();
+
+    // Longest block translated, in instructions
+    static const std::uint32_t MAX_BLOCK_INSTRUCTIONS{64};
+
+private:
+    struct Block
+    {
+        // Index of the first operation in ops
+        std::uint32_t first_op{};
+        // Operations run without touching the program counter
+        std::uint32_t body_ops{};
+        // Instructions covered by the block, counting both halves of fused pairs
+        std::uint32_t instruction_count{};
+        // Address right after the last instruction
+        std::uint16_t end{};
+        // Whether a control flow or memory writing operation follows the body
+        bool has_terminator{};
+    };
+
+    std::vector<Block> blocks;
+    std::vector<DecodedInstruction> ops;
+    // Index into blocks of the block starting at every address, -1 if not translated
+    std::array<std::int32_t, 4096> block_at{};
+    // Marks the memory bytes covered by a translated block
+    std::array<bool, 4096> code_map{};
+
+    // Translates the block starting at address. Returns its index in blocks
+    template <typename Quirks>
+    std::int32_t translate(const Chip8 &chip8, std::uint16_t address);
+
+    // Executes a single instruction without translating it, used when a block doesn't fit the remaining count
+    template <typename Quirks>
+    bool step(Chip8 &chip8);
+
+    // Runs a decoded instruction that writes memory, flushing the blocks if the write lands on translated code
+    bool execute_write(Chip8 &chip8, const DecodedInstruction &instruction);
+};
+
+#endif  // BLOCK_CACHE_HPP
@@ -1,41 +1,74 @@
 #ifndef CHIP8_HPP
 #define CHIP8_HPP
 
+#include <type_traits>
+
 #include "chip8_constants.hpp"
-#include "limited_stack.hpp"
+#include "random_generator.hpp"
 
-struct Chip8
+// Why the machine stopped executing instructions
+enum class FaultKind : std::uint8_t
 {
-    // CHIP-8 components
-    std::array<std::uint8_t, 16> registers{};
-    std::array<std::uint8_t, 4096> memory{};
-    std::uint16_t index_register{};
+    None,
+    // 2NNN with the stack full
+    StackOverflow,
+    // 00EE with the stack empty
+    StackUnderflow,
+    // An opcode no instruction decodes to, 0NNN included
+    InvalidOpcode,
+    // A fetch, or a memory access through the index register, past the end of memory, unless wrap_memory is set
+    MemoryOutOfRange,
+};
 
+// The first fault raised, with the instruction that raised it
+struct Fault
+{
+    FaultKind kind{FaultKind::None};
+    // Address of the faulting instruction
     std::uint16_t pc{};
-    // std::stack with a limited size of 16
-    limited_stack<std::uint16_t, 16> stack{};
+    // The faulting opcode, 0 when the fetch itself faulted
+    std::uint16_t opcode{};
+};
 
+// The whole machine state. It is a single trivially copyable block so instances can be copied, snapshotted and
+// compared with plain memory operations. Fields are ordered by how often the interpreter touches them
+struct Chip8
+{
+    // CHIP-8 components, most accessed first
+    std::array<std::uint8_t, 16> registers{};
+    std::uint16_t pc{};
+    std::uint16_t index_register{};
+    // Number of return addresses in the stack
+    std::uint8_t stack_pointer{};
     std::uint8_t delay_timer{};
     std::uint8_t sound_timer{};
 
     std::array<std::uint8_t, 16> keys{};
-    std::array<std::uint32_t, WINDOW_WIDTH * WINDOW_HEIGHT> display{};
+    std::array<std::uint16_t, STACK_SIZE> stack{};
 
     // CHIP-8 configuration options
     // Use original COSMAC VIP opcode interpretations
     bool cosmac{false};
     // Use Amiga opcode interpretations
     bool amiga{false};
-    // Mute all sound
-    bool mute{false};
+    // Wrap memory accesses past 0xFFF around to 0x000, instead of raising a MemoryOutOfRange fault
+    bool wrap_memory{false};
 
     // CHIP-8 utils
     // Detect key release in opcode FX0A
-    int key_pressed{-1};
-    // Signal the need of rendering the screen
-    bool render{false};
-    // Store the precomputed sine values used for sound
-    std::array<int16_t, BEEP_SAMPLE_RATE> sine_table{};
+    std::int8_t key_pressed{-1};
+    // Display rows changed since the last present, bit N is row N
+    std::uint32_t dirty_rows{};
+    // Set instead of throwing or printing when an instruction can't execute, the run loops stop at it
+    Fault fault{};
+    // Source of the CXNN random numbers, seeded once at startup
+    RandomGenerator random{};
+
+    // One word per row, the most significant bit is the leftmost pixel
+    std::array<std::uint64_t, WINDOW_HEIGHT> display{};
+    std::array<std::uint8_t, 4096> memory{};
 };
 
+static_assert(std::is_trivially_copyable_v<Chip8>, "Chip8 must stay copyable as a plain block of memory");
+
 #endif  // CHIP8_HPP
@@ -11,8 +11,7 @@ const std::uint32_t TIMER_FREQUENCY{60};
 const std::uint32_t WINDOW_WIDTH{64};
 const std::uint32_t WINDOW_HEIGHT{32};
 
-const int BEEP_AMPLITDUDE{28000};
-const int BEEP_SAMPLE_RATE{44100};
+const std::uint32_t STACK_SIZE{16};
 
 const std::array<uint8_t, 80> FONT{
     0xF0, 0x90, 0x90, 0x90, 0xF0,  // 0
@@ -0,0 +1,587 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "emulator_utils.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace
+{
+const std::string CONFORMANCE_USAGE{
+    "Usage: /path/to/chip8_conformance /path/to/test_rom_directory<string> --goldens /path/to/goldens.txt "
+    "--update(optional) | --fuzz <int> --seed <int>(optional, default 0) "
+    "--instructions <int>(optional, default 1000000) "
+    "--engines switch,cached,block,jit(optional, default all) --threads <int>(optional) "
+    "--frequency <int>(optional, default 700) --platform <int>(optional, default 1)"};
+
+// Address the Timendus test suite reads the target platform from, skipping its menu when set
+const std::uint16_t PLATFORM_ADDRESS{0x1FF};
+
+// Programs every --fuzz run checks before the random ones, for cases the generator almost never produces. Each one
+// loops on its code, so it runs until the budget ends or it faults
+const std::vector<std::vector<std::uint8_t>> DIRECTED_PROGRAMS{
+    // ANNN then DXYN reading past the end of memory, a pair the block engine fuses
+    {0xAF, 0xFF, 0xD0, 0x1F, 0x70, 0x01, 0x12, 0x00},
+    // The same pair after straight-line code, the sprite ending one byte past the end of memory
+    {0x60, 0x05, 0x61, 0x03, 0xAF, 0xFC, 0xD0, 0x15, 0x70, 0x01, 0x12, 0x00},
+    // The sprite ending on the last byte of memory, which is in range
+    {0x60, 0x05, 0x61, 0x03, 0xAF, 0xFB, 0xD0, 0x15, 0x70, 0x01, 0x12, 0x00},
+};
+
+struct ConformanceOptions
+{
+    std::string rom_directory{};
+    std::string goldens_location{};
+    bool update{false};
+    std::uint64_t instructions{1000000};
+    std::vector<Engine> engines{};
+    std::size_t threads{};
+    std::uint32_t cycle_frecuency{700};
+    std::uint8_t platform{1};
+    // Random programs to run instead of the ROMs, 0 to run the ROMs
+    std::uint64_t fuzz{0};
+    std::uint64_t seed{0};
+};
+
+// A ROM, quirk set and budget, which must end on the same framebuffer whatever the engine
+using GoldenKey = std::tuple<std::string, std::string, std::uint64_t>;
+
+struct ConformanceJob
+{
+    std::size_t rom{};
+    QuirkSet quirk_set{};
+    Engine engine{};
+};
+
+struct ConformanceResult
+{
+    bool ok{false};
+    std::string error{};
+    std::uint64_t hash{};
+};
+
+// A random or directed program run under one quirk set, memory mode and engine
+struct FuzzJob
+{
+    // DIRECTED_PROGRAMS come first, the random programs follow
+    std::uint64_t program{};
+    QuirkSet quirk_set{};
+    bool wrap_memory{false};
+    Engine engine{};
+};
+
+struct FuzzResult
+{
+    FaultKind fault{FaultKind::None};
+    std::uint64_t executed{};
+    // state_hash() of the final machine
+    std::uint64_t hash{};
+};
+
+// Parses the conformance arguments. Returns -1 on error, 0 on success, and 1 if the --help option is encountered
+int parse_conformance_arguments(int argc, char *argv[], ConformanceOptions &options)
+{
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--help" || arg == "-h")
+        {
+            std::cout << "Runs every test ROM in a directory under every quirk set and engine, in parallel, and "
+                         "checks the final framebuffers against stored hashes.\n"
+                      << CONFORMANCE_USAGE << std::endl;
+            return 1;
+        }
+    }
+
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+
+        if (i == 1 && arg.rfind("--", 0) != 0)
+        {
+            options.rom_directory = arg;
+            continue;
+        }
+
+        if (arg == "--update")
+        {
+            options.update = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << ".\n" << CONFORMANCE_USAGE << std::endl;
+            return -1;
+        }
+
+        std::string value{argv[++i]};
+        try
+        {
+            if (arg == "--goldens")
+            {
+                options.goldens_location = value;
+            }
+            else if (arg == "--instructions")
+            {
+                options.instructions = std::stoull(value);
+            }
+            else if (arg == "--fuzz")
+            {
+                options.fuzz = std::stoull(value);
+            }
+            else if (arg == "--seed")
+            {
+                options.seed = std::stoull(value);
+            }
+            else if (arg == "--engines")
+            {
+                options.engines.clear();
+                for (const std::string &name : split(value, ','))
+                {
+                    Engine engine{};
+                    if (!parse_engine(name, engine))
+                    {
+                        throw std::invalid_argument("Unknown engine.");
+                    }
+                    options.engines.push_back(engine);
+                }
+            }
+            else if (arg == "--threads")
+            {
+                options.threads = std::stoul(value);
+            }
+            else if (arg == "--frequency")
+            {
+                options.cycle_frecuency = static_cast<std::uint32_t>(std::stoul(value));
+            }
+            else if (arg == "--platform")
+            {
+                const unsigned long platform{std::stoul(value)};
+                if (platform > 0xFF)
+                {
+                    throw std::out_of_range("Platform out of range.");
+                }
+                options.platform = static_cast<std::uint8_t>(platform);
+            }
+            else
+            {
+                std::cerr << "Unknown argument: " << arg << ".\n" << CONFORMANCE_USAGE << std::endl;
+                return -1;
+            }
+        }
+        catch (std::logic_error &)
+        {
+            std::cerr << "Invalid " << arg << " argument.\n" << CONFORMANCE_USAGE << std::endl;
+            return -1;
+        }
+    }
+
+    // Either ROMs checked against goldens, or random programs checked against each other
+    if (options.rom_directory.empty() == (options.fuzz == 0))
+    {
+        std::cerr << "Expected a test ROM directory or --fuzz.\n" << CONFORMANCE_USAGE << std::endl;
+        return -1;
+    }
+
+    if (options.fuzz == 0 && options.goldens_location.empty())
+    {
+        std::cerr << "Missing --goldens argument.\n" << CONFORMANCE_USAGE << std::endl;
+        return -1;
+    }
+
+    if (options.instructions == 0)
+    {
+        std::cerr << "Invalid --instructions argument.\n" << CONFORMANCE_USAGE << std::endl;
+        return -1;
+    }
+
+    if (options.engines.empty())
+    {
+        options.engines = {Engine::Switch, Engine::Cached, Engine::Block, Engine::Jit};
+    }
+
+    if (options.threads == 0)
+    {
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    if (options.cycle_frecuency == 0)
+    {
+        std::cerr << "Invalid --frequency argument.\n" << CONFORMANCE_USAGE << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Reads "rom quirks instructions hash" lines, skipping blank lines and # comments. A missing file is an empty set,
+// so the first --update can create it
+bool load_goldens(const std::string &path, std::map<GoldenKey, std::uint64_t> &goldens)
+{
+    std::ifstream goldens_file(path);
+    if (!goldens_file)
+    {
+        return true;
+    }
+
+    std::string line{};
+    std::uint64_t line_number{0};
+    while (std::getline(goldens_file, line))
+    {
+        line_number++;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string rom{};
+        std::string quirks{};
+        std::uint64_t instructions{};
+        std::uint64_t hash{};
+        if (!(fields >> rom >> quirks >> instructions >> std::hex >> hash))
+        {
+            std::cerr << "Malformed goldens file at line " << line_number << ". Path: " << path << std::endl;
+            return false;
+        }
+        goldens[{rom, quirks, instructions}] = hash;
+    }
+
+    return true;
+}
+
+bool save_goldens(const std::string &path, const std::map<GoldenKey, std::uint64_t> &goldens)
+{
+    std::ofstream goldens_file(path);
+
+    if (!goldens_file)
+    {
+        std::cerr << "Failed to create the file. Path: " << path << std::endl;
+        return false;
+    }
+
+    goldens_file << "# Final framebuffer hashes checked by chip8_conformance, regenerate with --update\n"
+                 << "# rom quirks instructions framebuffer_hash\n";
+    for (const auto &[key, hash] : goldens)
+    {
+        goldens_file << std::get<0>(key) << ' ' << std::get<1>(key) << ' ' << std::get<2>(key) << ' '
+                     << hash_string(hash) << '\n';
+    }
+
+    return static_cast<bool>(goldens_file);
+}
+
+ConformanceResult run_job(const ConformanceOptions &options, const std::string &rom, const ConformanceJob &job)
+{
+    ConformanceResult result{};
+
+    Chip8 chip8{};
+    chip8.cosmac = job.quirk_set.cosmac;
+    chip8.amiga = job.quirk_set.amiga;
+    chip8.random.seed(0);
+
+    load_font(chip8);
+    chip8.memory[PLATFORM_ADDRESS] = options.platform;
+
+    if (!load_ROM(chip8, (std::filesystem::path(options.rom_directory) / rom).string()))
+    {
+        result.error = "load_failed";
+        return result;
+    }
+
+    chip8.pc = START_ADDRESS;
+
+    Interpreter interpreter(chip8, job.engine);
+
+    std::uint64_t frames{0};
+    result.ok = run_headless(interpreter, chip8, options.instructions, 0, options.cycle_frecuency, frames);
+    if (!result.ok)
+    {
+        result.error = fault_name(chip8.fault.kind);
+    }
+
+    result.hash = framebuffer_hash(chip8);
+
+    return result;
+}
+
+// Hash of everything a program can change, so any divergence between two runs shows up
+std::uint64_t state_hash(const Chip8 &chip8)
+{
+    std::uint64_t hash{framebuffer_hash(chip8)};
+    const auto mix{[&hash](const std::uint64_t value) { hash = (hash ^ value) * 0x100000001B3; }};
+
+    for (const std::uint8_t value : chip8.registers)
+    {
+        mix(value);
+    }
+    for (const std::uint16_t address : chip8.stack)
+    {
+        mix(address);
+    }
+    for (const std::uint8_t value : chip8.memory)
+    {
+        mix(value);
+    }
+    mix(chip8.pc);
+    mix(chip8.index_register);
+    mix(chip8.stack_pointer);
+    mix(chip8.delay_timer);
+    mix(chip8.sound_timer);
+    mix(static_cast<std::uint64_t>(chip8.fault.kind));
+    mix(chip8.fault.pc);
+    mix(chip8.fault.opcode);
+
+    return hash;
+}
+
+FuzzResult run_fuzz_job(const ConformanceOptions &options, const FuzzJob &job)
+{
+    Chip8 chip8{};
+    chip8.cosmac = job.quirk_set.cosmac;
+    chip8.amiga = job.quirk_set.amiga;
+    chip8.wrap_memory = job.wrap_memory;
+    chip8.random.seed(options.seed + job.program);
+
+    load_font(chip8);
+    if (job.program < DIRECTED_PROGRAMS.size())
+    {
+        const std::vector<std::uint8_t> &program{DIRECTED_PROGRAMS[job.program]};
+        std::copy(program.begin(), program.end(), chip8.memory.begin() + START_ADDRESS);
+    }
+    else
+    {
+        load_random_program(chip8, options.seed + job.program - DIRECTED_PROGRAMS.size());
+    }
+    chip8.pc = START_ADDRESS;
+
+    Interpreter interpreter(chip8, job.engine);
+
+    std::uint64_t frames{0};
+    run_headless(interpreter, chip8, options.instructions, 0, options.cycle_frecuency, frames);
+
+    return {chip8.fault.kind, interpreter.executed(), state_hash(chip8)};
+}
+
+// Runs every random program under every quirk set, both memory modes and every engine. Engines must agree with the
+// first one listed, and a program that never reaches past the end of memory must end the same whether memory wraps
+// or faults. The digest of every final state must also match between regular and CHIP8_CHECKED_MEMORY builds
+int run_fuzz(const ConformanceOptions &options)
+{
+    const std::uint64_t programs{DIRECTED_PROGRAMS.size() + options.fuzz};
+    std::vector<FuzzJob> jobs{};
+    for (std::uint64_t program{0}; program < programs; program++)
+    {
+        for (const QuirkSet &quirk_set : all_quirk_sets())
+        {
+            for (const bool wrap_memory : {false, true})
+            {
+                for (const Engine engine : options.engines)
+                {
+                    jobs.push_back({program, quirk_set, wrap_memory, engine});
+                }
+            }
+        }
+    }
+
+    std::vector<FuzzResult> results(jobs.size());
+
+    const auto start{std::chrono::steady_clock::now()};
+
+    run_work_stealing(jobs.size(),
+                      options.threads,
+                      [&](const std::size_t index)
+                      {
+                          results[index] = run_fuzz_job(options, jobs[index]);
+                      });
+
+    const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+
+    // Jobs of the same program and quirk set are next to each other, the faulting mode's engines first
+    const std::size_t engines{options.engines.size()};
+    std::size_t failures{0};
+    std::size_t out_of_range{0};
+    std::uint64_t digest{0xCBF29CE484222325};
+    for (std::size_t i{0}; i < jobs.size(); i++)
+    {
+        const FuzzJob &job{jobs[i]};
+        const FuzzResult &result{results[i]};
+        const FuzzResult &engine_reference{results[i - i % engines]};
+        const FuzzResult &mode_reference{results[i - i % (2 * engines)]};
+
+        digest = (digest ^ result.hash) * 0x100000001B3;
+        digest = (digest ^ result.executed) * 0x100000001B3;
+
+        std::string status{"ok"};
+        if (result.executed != engine_reference.executed || result.hash != engine_reference.hash)
+        {
+            status = "engine_mismatch";
+        }
+        else if (job.wrap_memory && mode_reference.fault != FaultKind::MemoryOutOfRange &&
+                 (result.executed != mode_reference.executed || result.hash != mode_reference.hash))
+        {
+            status = "mode_mismatch";
+        }
+
+        if (!job.wrap_memory && i % engines == 0 && result.fault == FaultKind::MemoryOutOfRange)
+        {
+            out_of_range++;
+        }
+
+        if (status != "ok")
+        {
+            failures++;
+            const bool directed{job.program < DIRECTED_PROGRAMS.size()};
+            std::cout << status << ": " << (directed ? "directed program " : "program ")
+                      << (directed ? job.program : options.seed + job.program - DIRECTED_PROGRAMS.size()) << " "
+                      << job.quirk_set.name << " " << (job.wrap_memory ? "wrap" : "fault") << " "
+                      << engine_name(job.engine) << " " << hash_string(result.hash) << std::endl;
+        }
+    }
+
+    std::cout << "programs: " << programs << "\n"
+              << "runs: " << jobs.size() << "\n"
+              << "failures: " << failures << "\n"
+              << "out_of_range: " << out_of_range << "\n"
+              << "digest: " << hash_string(digest) << "\n"
+              << "threads: " << options.threads << "\n"
+              << "seconds: " << elapsed.count() << std::endl;
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    ConformanceOptions options{};
+
+    switch (parse_conformance_arguments(argc, argv, options))
+    {
+        case -1:
+            std::cerr << "Fatal error, execution aborted." << std::endl;
+            return EXIT_FAILURE;
+        case 1:
+            return EXIT_SUCCESS;
+        default:
+            break;
+    }
+
+    if (options.fuzz != 0)
+    {
+        return run_fuzz(options);
+    }
+
+    std::vector<std::string> roms{};
+    std::map<GoldenKey, std::uint64_t> goldens{};
+    if (!find_roms(options.rom_directory, roms) || !load_goldens(options.goldens_location, goldens))
+    {
+        std::cerr << "Fatal error, execution aborted." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (roms.empty())
+    {
+        std::cerr << "No .ch8 files found. Path: " << options.rom_directory << "\n"
+                  << "Fatal error, execution aborted." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<ConformanceJob> jobs{};
+    for (std::size_t rom{0}; rom < roms.size(); rom++)
+    {
+        for (const QuirkSet &quirk_set : all_quirk_sets())
+        {
+            for (const Engine engine : options.engines)
+            {
+                jobs.push_back({rom, quirk_set, engine});
+            }
+        }
+    }
+
+    // Every job writes only its own result, so no locking is needed
+    std::vector<ConformanceResult> results(jobs.size());
+
+    const auto start{std::chrono::steady_clock::now()};
+
+    run_work_stealing(jobs.size(),
+                      options.threads,
+                      [&](const std::size_t index)
+                      {
+                          results[index] = run_job(options, roms[jobs[index].rom], jobs[index]);
+                      });
+
+    const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+
+    // Jobs of the same case are next to each other, the first engine listed is the reference when updating
+    std::size_t failures{0};
+    std::size_t missing{0};
+    std::map<GoldenKey, std::uint64_t> updated{};
+    for (std::size_t i{0}; i < jobs.size(); i++)
+    {
+        const ConformanceJob &job{jobs[i]};
+        const ConformanceResult &result{results[i]};
+        const GoldenKey key{roms[job.rom], job.quirk_set.name, options.instructions};
+        if (options.update && updated.find(key) == updated.end())
+        {
+            updated[key] = result.hash;
+        }
+
+        const std::map<GoldenKey, std::uint64_t> &expected{options.update ? updated : goldens};
+        const auto golden{expected.find(key)};
+        std::string status{"ok"};
+        if (!result.ok)
+        {
+            status = result.error;
+            failures++;
+        }
+        else if (golden == expected.end())
+        {
+            status = "missing";
+            missing++;
+        }
+        else if (golden->second != result.hash)
+        {
+            status = "mismatch";
+            failures++;
+        }
+
+        if (status != "ok")
+        {
+            std::cout << status << ": " << roms[job.rom] << " " << job.quirk_set.name << " "
+                      << engine_name(job.engine) << " " << hash_string(result.hash) << std::endl;
+        }
+    }
+
+    std::cout << "roms: " << roms.size() << "\n"
+              << "runs: " << jobs.size() << "\n"
+              << "failures: " << failures << "\n"
+              << "missing: " << missing << "\n"
+              << "threads: " << options.threads << "\n"
+              << "seconds: " << elapsed.count() << std::endl;
+
+    if (options.update)
+    {
+        // Cases of ROMs no longer in the directory or other budgets are kept
+        for (const auto &[key, hash] : updated)
+        {
+            goldens[key] = hash;
+        }
+
+        if (!save_goldens(options.goldens_location, goldens))
+        {
+            std::cerr << "Fatal error, execution aborted." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return failures == 0 && missing == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
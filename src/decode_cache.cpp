@@ -0,0 +1,348 @@
+#include "decode_cache.hpp"
+
+#include <algorithm>
+
+#include "emulator_utils.hpp"
+#include "instructions.hpp"
+#include "opcode_table.hpp"
+
+namespace
+{
+// Thin wrappers giving every op_* function the same signature
+bool cached_00E0(Chip8 &chip8, const DecodedInstruction &)
+{
+    op_00E0(chip8);
+    return true;
+}
+
+bool cached_00EE(Chip8 &chip8, const DecodedInstruction &)
+{
+    op_00EE(chip8);
+    return chip8.fault.kind == FaultKind::None;
+}
+
+bool cached_1NNN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_1NNN(chip8, instruction.opcode);
+    return true;
+}
+
+bool cached_2NNN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_2NNN(chip8, instruction.opcode);
+    return chip8.fault.kind == FaultKind::None;
+}
+
+bool cached_3XNN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_3XNN(chip8, instruction.opcode, instruction.x);
+    return true;
+}
+
+bool cached_4XNN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_4XNN(chip8, instruction.opcode, instruction.x);
+    return true;
+}
+
+bool cached_5XY0(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_5XY0(chip8, instruction.x, instruction.y);
+    return true;
+}
+
+bool cached_6XNN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_6XNN(chip8, instruction.opcode, instruction.x);
+    return true;
+}
+
+bool cached_7XNN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_7XNN(chip8, instruction.opcode, instruction.x);
+    return true;
+}
+
+bool cached_8XY0(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_8XY0(chip8, instruction.x, instruction.y);
+    return true;
+}
+
+template <typename Quirks>
+bool cached_8XY1(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_8XY1<Quirks>(chip8, instruction.x, instruction.y);
+    return true;
+}
+
+template <typename Quirks>
+bool cached_8XY2(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_8XY2<Quirks>(chip8, instruction.x, instruction.y);
+    return true;
+}
+
+template <typename Quirks>
+bool cached_8XY3(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_8XY3<Quirks>(chip8, instruction.x, instruction.y);
+    return true;
+}
+
+bool cached_8XY4(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_8XY4(chip8, instruction.x, instruction.y);
+    return true;
+}
+
+bool cached_8XY5(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_8XY5(chip8, instruction.x, instruction.y);
+    return true;
+}
+
+template <typename Quirks>
+bool cached_8XY6(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_8XY6<Quirks>(chip8, instruction.x, instruction.y);
+    return true;
+}
+
+bool cached_8XY7(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_8XY7(chip8, instruction.x, instruction.y);
+    return true;
+}
+
+template <typename Quirks>
+bool cached_8XYE(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_8XYE<Quirks>(chip8, instruction.x, instruction.y);
+    return true;
+}
+
+bool cached_9XY0(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_9XY0(chip8, instruction.x, instruction.y);
+    return true;
+}
+
+bool cached_ANNN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_ANNN(chip8, instruction.opcode);
+    return true;
+}
+
+template <typename Quirks>
+bool cached_BNNN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_BNNN<Quirks>(chip8, instruction.opcode, instruction.x);
+    return true;
+}
+
+bool cached_CXNN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_CXNN(chip8, instruction.opcode, instruction.x);
+    return true;
+}
+
+template <typename Quirks>
+bool cached_DXYN(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_DXYN<Quirks>(chip8, instruction.opcode, instruction.x, instruction.y);
+    return chip8.fault.kind == FaultKind::None;
+}
+
+bool cached_EX9E(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_EX9E(chip8, instruction.x);
+    return true;
+}
+
+bool cached_EXA1(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_EXA1(chip8, instruction.x);
+    return true;
+}
+
+bool cached_FX07(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_FX07(chip8, instruction.x);
+    return true;
+}
+
+template <typename Quirks>
+bool cached_FX0A(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_FX0A<Quirks>(chip8, instruction.x);
+    return true;
+}
+
+bool cached_FX15(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_FX15(chip8, instruction.x);
+    return true;
+}
+
+bool cached_FX18(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_FX18(chip8, instruction.x);
+    return true;
+}
+
+template <typename Quirks>
+bool cached_FX1E(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_FX1E<Quirks>(chip8, instruction.x);
+    return true;
+}
+
+bool cached_FX29(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_FX29(chip8, instruction.x);
+    return true;
+}
+
+bool cached_FX33(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_FX33(chip8, instruction.opcode, instruction.x);
+    return chip8.fault.kind == FaultKind::None;
+}
+
+template <typename Quirks>
+bool cached_FX55(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_FX55<Quirks>(chip8, instruction.opcode, instruction.x);
+    return chip8.fault.kind == FaultKind::None;
+}
+
+template <typename Quirks>
+bool cached_FX65(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    op_FX65<Quirks>(chip8, instruction.opcode, instruction.x);
+    return chip8.fault.kind == FaultKind::None;
+}
+
+bool cached_invalid(Chip8 &chip8, const DecodedInstruction &instruction)
+{
+    raise_fault(chip8, FaultKind::InvalidOpcode, instruction.opcode);
+    return false;
+}
+}  // namespace
+
+template <typename Quirks>
+bool DecodeCache::step(Chip8 &chip8)
+{
+    // The last memory byte can't hold a full opcode, leave the fetch error to the switch decoder
+    if (chip8.pc >= entries.size() - 1)
+    {
+        return ::step<Quirks>(chip8);
+    }
+
+    DecodedInstruction &slot{entries[chip8.pc]};
+    if (!slot.handler)
+    {
+        slot = decode<Quirks>(chip8.memory[chip8.pc] << 8 | chip8.memory[chip8.pc + 1]);
+    }
+
+    chip8.pc += 2;
+
+    if (slot.write_length == 0)
+    {
+        return slot.handler(chip8, slot);
+    }
+
+    // The write may overwrite this very slot, so copy what is needed first
+    const std::uint16_t address{chip8.index_register};
+    const std::uint8_t length{slot.write_length};
+    const bool success{slot.handler(chip8, slot)};
+    invalidate(address, length);
+    return success;
+}
+
+void DecodeCache::invalidate(const std::uint32_t address, const std::uint32_t length)
+{
+    // An instruction starting one byte before the range also overlaps it
+    const std::uint32_t first{address > 0 ? address - 1 : 0};
+    const std::uint32_t last{std::min<std::uint32_t>(address + length, entries.size())};
+
+    for (std::uint32_t i{first}; i < last; i++)
+    {
+        entries[i].handler = nullptr;
+    }
+
+    // On machines with wrap_memory, a range running past the end of memory continues at address 0
+    for (std::uint32_t i{static_cast<std::uint32_t>(entries.size())}; i < address + length; i++)
+    {
+        entries[i - entries.size()].handler = nullptr;
+    }
+}
+
+void DecodeCache::clear()
+{
+    entries.fill(DecodedInstruction{});
+}
+
+template <typename Quirks>
+DecodedInstruction DecodeCache::decode(const std::uint16_t opcode)
+{
+    // Indexed by OpcodeHandler
+    static constexpr std::array<bool (*)(Chip8 &, const DecodedInstruction &), OPCODE_HANDLER_COUNT> handlers{
+        cached_00E0,
+        cached_00EE,
+        cached_1NNN,
+        cached_2NNN,
+        cached_3XNN,
+        cached_4XNN,
+        cached_5XY0,
+        cached_6XNN,
+        cached_7XNN,
+        cached_8XY0,
+        cached_8XY1<Quirks>,
+        cached_8XY2<Quirks>,
+        cached_8XY3<Quirks>,
+        cached_8XY4,
+        cached_8XY5,
+        cached_8XY6<Quirks>,
+        cached_8XY7,
+        cached_8XYE<Quirks>,
+        cached_9XY0,
+        cached_ANNN,
+        cached_BNNN<Quirks>,
+        cached_CXNN,
+        cached_DXYN<Quirks>,
+        cached_EX9E,
+        cached_EXA1,
+        cached_FX07,
+        cached_FX0A<Quirks>,
+        cached_FX15,
+        cached_FX18,
+        cached_FX1E<Quirks>,
+        cached_FX29,
+        cached_FX33,
+        cached_FX55<Quirks>,
+        cached_FX65<Quirks>,
+        cached_invalid,
+    };
+
+    const OpcodeEntry &entry{opcode_entry(opcode)};
+    DecodedInstruction instruction{handlers[static_cast<std::size_t>(entry.handler)], opcode, entry.x, entry.y, 0, 0};
+
+    if (entry.handler == OpcodeHandler::OpFX33)
+    {
+        instruction.write_length = 3;
+    }
+    else if (entry.handler == OpcodeHandler::OpFX55)
+    {
+        instruction.write_length = entry.x + 1;
+    }
+
+    return instruction;
+}
+
+#define INSTANTIATE_DECODE_CACHE(Quirks)                                                                               \
+    template bool DecodeCache::step<Quirks>(Chip8 &);                                                                  \
+    template DecodedInstruction DecodeCache::decode<Quirks>(std::uint16_t);
+
+CHIP8_FOR_EACH_QUIRK_PROFILE(INSTANTIATE_DECODE_CACHE)
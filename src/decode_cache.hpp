@@ -0,0 +1,49 @@
+#ifndef DECODE_CACHE_HPP
+#define DECODE_CACHE_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "chip8.hpp"
+
+// Instruction with its operands extracted ahead of time
+struct DecodedInstruction
+{
+    // Executes the instruction. Returns false if it raised a fault. nullptr marks a slot not decoded yet
+    bool (*handler)(Chip8 &chip8, const DecodedInstruction &instruction){nullptr};
+    std::uint16_t opcode{};
+    // Second and third nibbles, the X and Y register indexes
+    std::uint8_t x{};
+    std::uint8_t y{};
+    // Number of bytes written to memory starting at the index register, only nonzero for FX33 and FX55
+    std::uint8_t write_length{};
+    // Second opcode of a fused instruction pair, see BlockCache
+    std::uint16_t fused_opcode{};
+};
+
+// Caches the decoded instruction found at every memory address, so each address is only decoded once. Instructions
+// writing into memory (FX33, FX55) invalidate the slots they overwrite, keeping self-modifying ROMs correct
+class DecodeCache
+{
+public:
+    // Executes the instruction pointed to by the program counter, decoding it first if needed. Returns false if it
+    // raised a fault. Slots keep the handlers of the profile they were decoded with, so the cache must be cleared
+    // before stepping with another one
+    template <typename Quirks>
+    bool step(Chip8 &chip8);
+
+    // Drops the decoded instructions overlapping the given memory range
+    void invalidate(std::uint32_t address, std::uint32_t length);
+
+    // Drops every decoded instruction, needed whenever memory is rewritten from outside the interpreter
+    void clear();
+
+    // Decodes a single opcode into the handlers of the given quirk profile
+    template <typename Quirks>
+    static DecodedInstruction decode(std::uint16_t opcode);
+
+private:
+    std::array<DecodedInstruction, 4096> entries{};
+};
+
+#endif  // DECODE_CACHE_HPP
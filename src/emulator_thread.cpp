@@ -0,0 +1,294 @@
+#include "emulator_thread.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "emulator_utils.hpp"
+#include "execution_stats.hpp"
+
+EmulatorThread::EmulatorThread(Chip8 &chip8,
+                               const ExecutionOptions &execution_options,
+                               const std::uint32_t cycle_frecuency) :
+    chip8(chip8),
+    interpreter(chip8, execution_options.engine),
+    present_mode(execution_options.present_mode),
+    stats_path(execution_options.stats_path),
+    record_path(execution_options.record_path),
+    replay(execution_options.replay),
+    cpu_scheduler(cycle_frecuency),
+    timer_scheduler(TIMER_FREQUENCY)
+{
+    recording.seed = execution_options.seed.value_or(0);
+    recording.cosmac = chip8.cosmac;
+    recording.amiga = chip8.amiga;
+    recording.wrap_memory = chip8.wrap_memory;
+    recording.mute = execution_options.mute;
+    recording.cycle_frecuency = cycle_frecuency;
+}
+
+EmulatorThread::~EmulatorThread()
+{
+    stop();
+}
+
+void EmulatorThread::start()
+{
+    if (thread.joinable())
+    {
+        return;
+    }
+
+    stop_requested.store(false, std::memory_order_relaxed);
+    frames_published.store(0, std::memory_order_relaxed);
+    frames_dropped.store(0, std::memory_order_relaxed);
+
+    capture_frame();
+    publish_frame();
+    thread = std::thread(&EmulatorThread::run, this);
+}
+
+void EmulatorThread::stop()
+{
+    stop_requested.store(true, std::memory_order_relaxed);
+
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+bool EmulatorThread::set_key(const std::uint8_t key, const bool pressed)
+{
+    return key_events.push({static_cast<std::uint8_t>(key & 0x0F), pressed, CycleScheduler::clock::now()});
+}
+
+void EmulatorThread::run()
+{
+    // Wake up once per timer tick, which is also the rate frames are published at
+    const std::chrono::nanoseconds interval{std::chrono::nanoseconds(std::chrono::seconds(1)) / TIMER_FREQUENCY};
+
+    CycleScheduler::clock::time_point wake_up{CycleScheduler::clock::now()};
+    cpu_scheduler.reset(wake_up);
+    timer_scheduler.reset(wake_up);
+
+    while (!stop_requested.load(std::memory_order_relaxed))
+    {
+        const CycleScheduler::clock::time_point now{CycleScheduler::clock::now()};
+
+        if (!run_due(now))
+        {
+            std::cerr << fault_message(chip8.fault) << std::endl;
+            execution_failed.store(true, std::memory_order_release);
+            break;
+        }
+
+        // Without draw boundaries, or when the program stopped producing them, present whatever is on the display.
+        // Key events that didn't change it still get a frame, so their latency is measured up to the next present
+        ticks_since_boundary++;
+        const bool drawn{chip8.dirty_rows != 0 &&
+                         (present_mode == PresentMode::Tick || ticks_since_boundary > DRAW_FALLBACK_TICKS)};
+        const bool input_only{chip8.dirty_rows == 0 && input_time != CycleScheduler::clock::time_point{}};
+        if (!frame_pending && (drawn || input_only))
+        {
+            capture_frame();
+        }
+
+        if (frame_pending)
+        {
+            publish_frame();
+        }
+
+        // Don't try to catch up on missed wake ups, the schedulers already account for the elapsed time
+        wake_up += interval;
+        if (wake_up < now)
+        {
+            wake_up = now + interval;
+        }
+        std::this_thread::sleep_until(wake_up);
+    }
+
+#ifdef CHIP8_ENABLE_STATS
+    // The counters belong to this thread, so they are saved before it ends
+    if (!stats_path.empty())
+    {
+        save_execution_stats(execution_stats, stats_path);
+    }
+#endif
+
+    if (!record_path.empty())
+    {
+        recording.end_instruction = interpreter.executed();
+        recording.end_hash = framebuffer_hash(chip8);
+        save_input_log(recording, record_path);
+    }
+}
+
+bool EmulatorThread::run_due(const CycleScheduler::clock::time_point now)
+{
+    const std::uint64_t cycles{cpu_scheduler.advance(now)};
+    const std::uint64_t timer_ticks{timer_scheduler.advance(now)};
+
+    if (replay)
+    {
+        return replay_due(cycles);
+    }
+
+    if (timer_ticks == 0)
+    {
+        apply_key_events();
+        return run_cycles(cycles);
+    }
+
+    // Spread the cycles evenly between the timer ticks due, with key events applied at the start of each batch
+    for (std::uint64_t tick{0}; tick < timer_ticks; tick++)
+    {
+        apply_key_events();
+        if (!run_cycles(cycles * (tick + 1) / timer_ticks - cycles * tick / timer_ticks))
+        {
+            return false;
+        }
+
+        timer_tick();
+    }
+
+    return true;
+}
+
+bool EmulatorThread::replay_due(const std::uint64_t cycles)
+{
+    // The keyboard has no say during a replay
+    while (key_events.front() != nullptr)
+    {
+        key_events.pop();
+    }
+
+    if (replay_finished)
+    {
+        return true;
+    }
+
+    const std::uint64_t limit{std::min(interpreter.executed() + cycles, replay->end_instruction)};
+    if (!replay_input(
+            *replay,
+            replay_event,
+            chip8,
+            interpreter,
+            limit,
+            [this](const std::uint64_t count) { return run_cycles(count); },
+            [this]() { timer_tick(); }))
+    {
+        return false;
+    }
+
+    if (interpreter.executed() >= replay->end_instruction)
+    {
+        replay_finished = true;
+        std::cout << "Replay finished after " << interpreter.executed() << " instructions, the framebuffer "
+                  << (framebuffer_hash(chip8) == replay->end_hash ? "matches" : "differs from") << " the recording."
+                  << std::endl;
+    }
+
+    return true;
+}
+
+void EmulatorThread::timer_tick()
+{
+    const bool sound{chip8.sound_timer > 0};
+    if (sound)
+    {
+        sound_tick_count.fetch_add(1, std::memory_order_release);
+    }
+    sound_running.store(sound, std::memory_order_release);
+
+    tick_timers(chip8);
+
+    if (!record_path.empty())
+    {
+        recording.events.push_back({interpreter.executed(), TIMER_TICK_EVENT, false});
+    }
+}
+
+void EmulatorThread::apply_key_events()
+{
+    std::uint16_t changed{0};
+    for (const KeyEvent *event{key_events.front()}; event != nullptr; event = key_events.front())
+    {
+        // A second edge of the same key waits for the next batch
+        const std::uint16_t bit{static_cast<std::uint16_t>(1u << event->key)};
+        if ((changed & bit) != 0)
+        {
+            break;
+        }
+        changed |= bit;
+
+        chip8.keys[event->key] = event->pressed ? 0x1 : 0x0;
+        if (!record_path.empty())
+        {
+            recording.events.push_back({interpreter.executed(), event->key, event->pressed});
+        }
+        if (input_time == CycleScheduler::clock::time_point{} || event->time < input_time)
+        {
+            input_time = event->time;
+        }
+
+        key_events.pop();
+    }
+}
+
+bool EmulatorThread::run_cycles(const std::uint64_t count)
+{
+    if (present_mode == PresentMode::Tick)
+    {
+        return interpreter.run(count);
+    }
+
+    // Reading the delay timer (FX07) or waiting for a key (FX0A) right after drawing marks a finished frame. The
+    // interpreter stops in front of it, the capture clears dirty_rows and the rest of the batch carries on
+    const std::uint64_t end{interpreter.executed() + count};
+    while (interpreter.executed() < end)
+    {
+        if (!interpreter.run_until_frame_wait(end - interpreter.executed()))
+        {
+            return false;
+        }
+
+        if (at_frame_wait(chip8))
+        {
+            capture_frame();
+            ticks_since_boundary = 0;
+        }
+    }
+
+    return true;
+}
+
+void EmulatorThread::capture_frame()
+{
+    // A capture still pending was never published, so it never had a chance to be shown
+    if (frame_pending)
+    {
+        frames_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Frame &frame{frames.back()};
+    frame.display = chip8.display;
+    // A pending capture being replaced keeps its input time, its input is shown by this frame instead
+    if (!frame_pending || frame.input_time == CycleScheduler::clock::time_point{})
+    {
+        frame.input_time = input_time;
+    }
+    input_time = {};
+    chip8.dirty_rows = 0;
+    frame_pending = true;
+}
+
+void EmulatorThread::publish_frame()
+{
+    if (!frames.publish())
+    {
+        frames_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    frames_published.fetch_add(1, std::memory_order_relaxed);
+    frame_pending = false;
+}
@@ -0,0 +1,155 @@
+#ifndef EMULATOR_THREAD_HPP
+#define EMULATOR_THREAD_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "chip8.hpp"
+#include "emulator_utils.hpp"
+#include "input_log.hpp"
+#include "interpreter.hpp"
+#include "scheduler.hpp"
+#include "spsc_queue.hpp"
+#include "triple_buffer.hpp"
+
+// Runs the interpreter in real time on its own thread, so UI stalls don't slow down emulation. Finished frames go to
+// the presentation side through a triple buffer, sound as a running count of beeping ticks, and key events come in
+// through a lock-free queue. Once started, the thread owns the Chip8 until it is stopped.
+// Given a record path, the key transitions and timer ticks are logged with the instruction count they were applied at
+// and saved when the thread ends. Given a replay, keyboard events are ignored and the logged ones are applied at the
+// same instruction counts instead, so the session runs again instruction for instruction
+class EmulatorThread
+{
+public:
+    struct Frame
+    {
+        std::array<std::uint64_t, WINDOW_HEIGHT> display{};
+        // When the oldest key event applied since the previous frame was made, or the epoch if there was none
+        CycleScheduler::clock::time_point input_time{};
+    };
+
+    // Frame delivery counters since start()
+    struct FrameStats
+    {
+        std::uint64_t published{0};
+        // Finished frames replaced by a newer one before reaching the display
+        std::uint64_t dropped{0};
+    };
+
+    EmulatorThread(Chip8 &chip8, const ExecutionOptions &execution_options, std::uint32_t cycle_frecuency);
+    ~EmulatorThread();
+
+    EmulatorThread(const EmulatorThread &) = delete;
+    EmulatorThread &operator=(const EmulatorThread &) = delete;
+
+    void start();
+    // Stops the thread and waits for it to finish
+    void stop();
+
+    // Queues a key press or release, stamped with the current time. Must always be called from the same thread.
+    // Returns false if the queue is full and the event was dropped
+    bool set_key(std::uint8_t key, bool pressed);
+
+    // Picks up the newest finished frame, if any was published since the last call
+    bool acquire_frame()
+    {
+        return frames.acquire();
+    }
+
+    // The frame picked up by the last acquire_frame()
+    const Frame &frame() const
+    {
+        return frames.front();
+    }
+
+    // Number of timer ticks the sound timer has been running for since start, callable from any thread. The beep
+    // lasts exactly as many ticks as this grows by
+    std::uint64_t sound_ticks() const
+    {
+        return sound_tick_count.load(std::memory_order_acquire);
+    }
+
+    // Whether the sound timer was running on the last timer tick, callable from any thread
+    bool sound_on() const
+    {
+        return sound_running.load(std::memory_order_acquire);
+    }
+
+    FrameStats frame_stats() const
+    {
+        return {frames_published.load(std::memory_order_relaxed), frames_dropped.load(std::memory_order_relaxed)};
+    }
+
+    // Whether the thread stopped because an instruction failed
+    bool failed() const
+    {
+        return execution_failed.load(std::memory_order_acquire);
+    }
+
+private:
+    // Ticks without a draw boundary after which PresentMode::Draw falls back to presenting every tick
+    static const std::uint32_t DRAW_FALLBACK_TICKS{8};
+
+    struct KeyEvent
+    {
+        std::uint8_t key{0};
+        bool pressed{false};
+        CycleScheduler::clock::time_point time{};
+    };
+
+    Chip8 &chip8;
+    Interpreter interpreter;
+    PresentMode present_mode;
+    std::string stats_path;
+
+    std::string record_path;
+    InputLog recording{};
+    std::shared_ptr<const InputLog> replay;
+    // Next replay event to apply
+    std::size_t replay_event{0};
+    bool replay_finished{false};
+
+    CycleScheduler cpu_scheduler;
+    CycleScheduler timer_scheduler;
+
+    TripleBuffer<Frame> frames{};
+    // Whether the back frame holds a draw boundary capture waiting to be published
+    bool frame_pending{false};
+    std::uint32_t ticks_since_boundary{0};
+    std::atomic<std::uint64_t> frames_published{0};
+    std::atomic<std::uint64_t> frames_dropped{0};
+
+    SpscQueue<KeyEvent, 256> key_events{};
+    // Time of the oldest key event applied since the last frame capture
+    CycleScheduler::clock::time_point input_time{};
+    std::atomic<std::uint64_t> sound_tick_count{0};
+    std::atomic<bool> sound_running{false};
+
+    std::atomic<bool> stop_requested{false};
+    std::atomic<bool> execution_failed{false};
+    std::thread thread{};
+
+    void run();
+    // Applies the queued key events to the keypad. Each key changes at most once per call, so a press and release
+    // arriving together stay visible to the program, FX0A included, for at least one batch of instructions
+    void apply_key_events();
+    // Runs the CPU cycles and timer ticks due at now. Returns false if an instruction failed
+    bool run_due(CycleScheduler::clock::time_point now);
+    // Runs the CPU cycles due at now with the timer ticks and key transitions of the replay
+    bool replay_due(std::uint64_t cycles);
+    // Ticks the timers, keeping count of the beeping ticks
+    void timer_tick();
+    // Runs count instructions, capturing the display at draw boundaries in PresentMode::Draw
+    bool run_cycles(std::uint64_t count);
+    // Copies the display into the back frame and marks it as pending
+    void capture_frame();
+    // Publishes the back frame, counting it as dropped if the previous one was never acquired
+    void publish_frame();
+};
+
+#endif  // EMULATOR_THREAD_HPP
@@ -1,13 +1,103 @@
 #include "emulator_utils.hpp"
 
-#include <windows.h>
-
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
 
+#include "execution_stats.hpp"
 #include "instructions.hpp"
+#include "memory_access.hpp"
+#include "opcode_table.hpp"
+
+bool parse_quirk_set(const std::string &name, QuirkSet &quirk_set)
+{
+    if (name == "modern")
+    {
+        quirk_set = {name, false, false};
+    }
+    else if (name == "cosmac")
+    {
+        quirk_set = {name, true, false};
+    }
+    else if (name == "amiga")
+    {
+        quirk_set = {name, false, true};
+    }
+    else if (name == "cosmac+amiga")
+    {
+        quirk_set = {name, true, true};
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<QuirkSet> all_quirk_sets()
+{
+    std::vector<QuirkSet> quirk_sets{};
+    for (const std::string name : {"modern", "cosmac", "amiga", "cosmac+amiga"})
+    {
+        QuirkSet quirk_set{};
+        parse_quirk_set(name, quirk_set);
+        quirk_sets.push_back(quirk_set);
+    }
+
+    return quirk_sets;
+}
+
+std::vector<std::string> split(const std::string &value, const char separator)
+{
+    std::vector<std::string> parts{};
+    std::stringstream stream(value);
+    std::string part{};
+    while (std::getline(stream, part, separator))
+    {
+        parts.push_back(part);
+    }
+
+    return parts;
+}
+
+bool find_roms(const std::string &directory, std::vector<std::string> &roms)
+{
+    std::error_code error{};
+    std::filesystem::recursive_directory_iterator iterator(directory, error);
+    if (error)
+    {
+        std::cerr << "Failed to open the directory. Path: " << directory << std::endl;
+        return false;
+    }
+
+    for (const std::filesystem::directory_entry &entry : iterator)
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".ch8")
+        {
+            roms.push_back(entry.path().lexically_relative(directory).generic_string());
+        }
+    }
+
+    std::sort(roms.begin(), roms.end());
+    return true;
+}
+
+std::string hash_string(const std::uint64_t hash)
+{
+    char buffer[17]{};
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
 
 int parse_arguments(Chip8 &chip8,
+                    ExecutionOptions &execution_options,
                     int argc,
                     char *argv[],
                     std::string &rom_location,
@@ -16,7 +106,10 @@ int parse_arguments(Chip8 &chip8,
 {
     std::string emulator_usage{
         "Usage: /path/to/chip8.exe /path/to/rom<string> cycle_delay<int> window_scale<int> --cosmac(optional) "
-        "--amiga(optional) --mute(optional)"};
+        "--amiga(optional) --wrap-memory(optional) --mute(optional) --engine switch|cached|block|jit(optional) "
+        "--seed <int>(optional) --present tick|draw(optional) --audio-buffer <ms>(optional) "
+        "--stats /path/to/stats.json(optional) --record /path/to/input.log(optional) "
+        "--replay /path/to/input.log(optional)"};
 
     for (int i{1}; i < argc; i++)
     {
@@ -58,21 +151,184 @@ int parse_arguments(Chip8 &chip8,
 
     for (int i{4}; i < argc; i++)
     {
-        std::string arg{argv[i]};
-        if (arg == "--cosmac")
+        if (parse_option(chip8, execution_options, argc, argv, i) == -1)
+        {
+            std::cerr << emulator_usage << std::endl;
+            return -1;
+        }
+    }
+
+    if (!apply_replay_settings(chip8, execution_options, cycle_frecuency))
+    {
+        std::cerr << emulator_usage << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int parse_option(Chip8 &chip8, ExecutionOptions &execution_options, int argc, char *argv[], int &index)
+{
+    std::string arg{argv[index]};
+    if (arg == "--cosmac")
+    {
+        chip8.cosmac = true;
+    }
+    else if (arg == "--amiga")
+    {
+        chip8.amiga = true;
+    }
+    else if (arg == "--wrap-memory")
+    {
+        chip8.wrap_memory = true;
+    }
+    else if (arg == "--mute")
+    {
+        execution_options.mute = true;
+    }
+    else if (arg == "--engine")
+    {
+        if (index + 1 >= argc || !parse_engine(argv[index + 1], execution_options.engine))
+        {
+            std::cerr << "Invalid --engine argument." << std::endl;
+            return -1;
+        }
+        index++;
+    }
+    else if (arg == "--present")
+    {
+        const std::string mode{index + 1 < argc ? argv[index + 1] : ""};
+        if (mode == "tick")
         {
-            chip8.cosmac = true;
+            execution_options.present_mode = PresentMode::Tick;
         }
-        if (arg == "--amiga")
+        else if (mode == "draw")
         {
-            chip8.amiga = true;
+            execution_options.present_mode = PresentMode::Draw;
         }
-        if (arg == "--mute")
+        else
         {
-            chip8.mute = true;
+            std::cerr << "Invalid --present argument." << std::endl;
+            return -1;
         }
+        index++;
     }
-    return 0;
+    else if (arg == "--audio-buffer")
+    {
+        try
+        {
+            if (index + 1 >= argc)
+            {
+                throw std::invalid_argument("Missing value.");
+            }
+            const unsigned long buffer_ms{std::stoul(argv[index + 1])};
+            if (buffer_ms == 0 || buffer_ms > 1000)
+            {
+                throw std::out_of_range("Buffer length out of range.");
+            }
+            execution_options.audio_buffer_ms = static_cast<std::uint32_t>(buffer_ms);
+        }
+        catch (std::logic_error &)
+        {
+            std::cerr << "Invalid --audio-buffer argument." << std::endl;
+            return -1;
+        }
+        index++;
+    }
+    else if (arg == "--stats")
+    {
+        if (!execution_stats_enabled())
+        {
+            std::cerr << "Built without CHIP8_ENABLE_STATS, --stats is unavailable." << std::endl;
+            return -1;
+        }
+        if (index + 1 >= argc)
+        {
+            std::cerr << "Invalid --stats argument." << std::endl;
+            return -1;
+        }
+        execution_options.stats_path = argv[++index];
+    }
+    else if (arg == "--record")
+    {
+        if (index + 1 >= argc)
+        {
+            std::cerr << "Invalid --record argument." << std::endl;
+            return -1;
+        }
+        execution_options.record_path = argv[++index];
+    }
+    else if (arg == "--replay")
+    {
+        auto input_log{std::make_shared<InputLog>()};
+        if (index + 1 >= argc || !load_input_log(argv[index + 1], *input_log))
+        {
+            std::cerr << "Invalid --replay argument." << std::endl;
+            return -1;
+        }
+        execution_options.replay = std::move(input_log);
+        index++;
+    }
+    else if (arg == "--seed")
+    {
+        try
+        {
+            if (index + 1 >= argc)
+            {
+                throw std::invalid_argument("Missing value.");
+            }
+            execution_options.seed = std::stoull(argv[index + 1], nullptr, 0);
+        }
+        catch (std::logic_error &)
+        {
+            std::cerr << "Invalid --seed argument." << std::endl;
+            return -1;
+        }
+        index++;
+    }
+    else
+    {
+        return 0;
+    }
+    return 1;
+}
+
+bool apply_replay_settings(Chip8 &chip8, ExecutionOptions &execution_options, std::uint32_t &cycle_frecuency)
+{
+    if (!execution_options.replay)
+    {
+        return true;
+    }
+
+    if (!execution_options.record_path.empty())
+    {
+        std::cerr << "--record and --replay can't be used together." << std::endl;
+        return false;
+    }
+
+    chip8.cosmac = execution_options.replay->cosmac;
+    chip8.amiga = execution_options.replay->amiga;
+    chip8.wrap_memory = execution_options.replay->wrap_memory;
+    execution_options.seed = execution_options.replay->seed;
+    execution_options.mute = execution_options.replay->mute;
+    cycle_frecuency = execution_options.replay->cycle_frecuency;
+    return true;
+}
+
+std::uint64_t seed_random(Chip8 &chip8, const ExecutionOptions &execution_options)
+{
+    std::uint64_t seed{};
+    if (execution_options.seed)
+    {
+        seed = *execution_options.seed;
+    }
+    else
+    {
+        std::random_device random_device;
+        seed = static_cast<std::uint64_t>(random_device()) << 32 | random_device();
+    }
+
+    chip8.random.seed(seed);
+    return seed;
 }
 
 void load_font(Chip8 &chip8)
@@ -115,282 +371,391 @@ bool load_ROM(Chip8 &chip8, const std::string &rom_path)
     return true;
 }
 
-bool execute(Chip8 &chip8, const std::uint16_t opcode)
+bool get_pixel(const Chip8 &chip8, const std::uint32_t x, const std::uint32_t y)
 {
-    // Extract nibbles
-    std::uint8_t n1{}, n2{}, n3{}, n4{};
-    n1 = opcode >> 12;
-    n2 = (opcode >> 8) & 0xF;
-    n3 = (opcode >> 4) & 0xF;
-    n4 = opcode & 0xF;
-
-    // Decode instruction and call corresponding function
-    switch (n1)
-    {
-        // 00E0, 00EE
-        // 0NNN not implemented
-        case 0x0:
-            if (n2 != 0x0 || n3 != 0xE)
-            {
-                std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                return false;
-            }
+    return (chip8.display[y] >> (WINDOW_WIDTH - 1 - x) & 0x1) != 0;
+}
 
-            switch (n4)
-            {
-                case 0x0:
-                    op_00E0(chip8);
-                    break;
+std::uint64_t framebuffer_hash(const Chip8 &chip8)
+{
+    std::uint64_t hash{0xCBF29CE484222325};
+    for (const std::uint64_t row : chip8.display)
+    {
+        // Bytes hashed from the leftmost pixels, whatever the host byte order
+        for (int shift{56}; shift >= 0; shift -= 8)
+        {
+            hash ^= (row >> shift) & 0xFF;
+            hash *= 0x100000001B3;
+        }
+    }
 
-                case 0xE:
-                    op_00EE(chip8);
-                    break;
+    return hash;
+}
 
-                default:
-                    std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                    return false;
-            }
-            break;
+bool save_framebuffer(const Chip8 &chip8, const std::string &path)
+{
+    std::ofstream image_file(path);
 
-        // 1NNN
-        case 0x1:
-            op_1NNN(chip8, opcode);
-            break;
+    if (!image_file)
+    {
+        std::cerr << "Failed to create the file. Path: " << path << std::endl;
+        return false;
+    }
 
-        // 2NNN
-        case 0x2:
-            op_2NNN(chip8, opcode);
-            break;
+    // Plain PBM, 1 is a lit pixel
+    image_file << "P1\n" << WINDOW_WIDTH << " " << WINDOW_HEIGHT << "\n";
+    for (std::uint32_t y{0}; y < WINDOW_HEIGHT; y++)
+    {
+        for (std::uint32_t x{0}; x < WINDOW_WIDTH; x++)
+        {
+            image_file << (get_pixel(chip8, x, y) ? '1' : '0');
+        }
+        image_file << '\n';
+    }
 
-        // 3XNN
-        case 0x3:
-            op_3XNN(chip8, opcode, n2);
-            break;
+    return static_cast<bool>(image_file);
+}
+
+const char *fault_name(const FaultKind kind)
+{
+    switch (kind)
+    {
+        case FaultKind::StackOverflow:
+            return "stack_overflow";
+        case FaultKind::StackUnderflow:
+            return "stack_underflow";
+        case FaultKind::InvalidOpcode:
+            return "invalid_instruction";
+        case FaultKind::MemoryOutOfRange:
+            return "memory_out_of_range";
+        default:
+            return "none";
+    }
+}
 
-        // 4XNN
-        case 0x4:
-            op_4XNN(chip8, opcode, n2);
+std::string fault_message(const Fault &fault)
+{
+    std::string message{};
+    switch (fault.kind)
+    {
+        case FaultKind::StackOverflow:
+            message = "Stack overflow.";
+            break;
+        case FaultKind::StackUnderflow:
+            message = "Stack underflow.";
+            break;
+        case FaultKind::InvalidOpcode:
+            message = "Invalid instruction.";
+            break;
+        case FaultKind::MemoryOutOfRange:
+            message = "Memory access out of range.";
             break;
+        default:
+            return "No fault.";
+    }
 
-        // 5XY0
-        case 0x5:
-            if (n4 != 0x0)
-            {
-                std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                return false;
-            }
+    char context[48]{};
+    std::snprintf(context, sizeof(context), " Opcode: %04x, address: %03x", fault.opcode, fault.pc);
+    return message + context;
+}
 
-            op_5XY0(chip8, n2, n3);
-            break;
+void load_random_program(Chip8 &chip8, const std::uint64_t seed)
+{
+    const std::uint16_t templates[]{0x00E0, 0x1000, 0x2000, 0x3000, 0x4000, 0x5000, 0x6000, 0x7000, 0x8000, 0x8001,
+                                    0x8002, 0x8003, 0x8004, 0x8005, 0x8006, 0x8007, 0x800E, 0x9000, 0xA000, 0xB000,
+                                    0xC000, 0xD000, 0xE09E, 0xE0A1, 0xF007, 0xF00A, 0xF015, 0xF018, 0xF01E, 0xF029,
+                                    0xF033, 0xF055, 0xF065, 0x6000, 0x7000, 0x3000, 0x8004, 0x8005};
 
-        // 6XNN
-        case 0x6:
-            op_6XNN(chip8, opcode, n2);
-            break;
+    std::mt19937_64 generator(seed);
+    const std::uint32_t length{static_cast<std::uint32_t>(64 + generator() % 600)};
 
-        // 7XNN
-        case 0x7:
-            op_7XNN(chip8, opcode, n2);
-            break;
+    for (std::uint32_t address{START_ADDRESS}; address < START_ADDRESS + length; address += 2)
+    {
+        const std::uint16_t base{templates[generator() % std::size(templates)]};
+        std::uint16_t opcode{base};
 
-        // 8XY0, 8XY1, 8XY2, 8XY3, 8XY4, 8XY5, 8XY6, 8XY7, 8XYE
-        case 0x8:
-            switch (n4)
-            {
-                case 0x0:
-                    op_8XY0(chip8, n2, n3);
-                    break;
+        switch (base >> 12)
+        {
+            case 0x1:
+            case 0x2:
+            case 0xA:
+            case 0xB:
+                // Mostly aligned targets inside the program
+                opcode |= static_cast<std::uint16_t>(START_ADDRESS + (generator() % (length / 2)) * 2 +
+                                                     (generator() % 8 == 0 ? 1 : 0));
+                // Now and then an index anywhere in memory, so accesses through I reach its end
+                if (base == 0xA000 && generator() % 16 == 0)
+                {
+                    opcode = static_cast<std::uint16_t>(base | generator() % 0x1000);
+                }
+                break;
+            case 0x0:
+                break;
+            case 0x5:
+            case 0x8:
+            case 0x9:
+                opcode |= static_cast<std::uint16_t>((generator() % 16) << 8 | (generator() % 16) << 4);
+                break;
+            case 0xD:
+                opcode |=
+                    static_cast<std::uint16_t>((generator() % 16) << 8 | (generator() % 16) << 4 | generator() % 16);
+                break;
+            case 0xE:
+            case 0xF:
+                opcode |= static_cast<std::uint16_t>((generator() % 16) << 8);
+                break;
+            default:
+                opcode |= static_cast<std::uint16_t>((generator() % 16) << 8 | generator() % 256);
+                break;
+        }
 
-                case 0x1:
-                    op_8XY1(chip8, n2, n3);
-                    break;
+        // An occasional fully random word, which is often invalid
+        if (generator() % 50 == 0)
+        {
+            opcode = static_cast<std::uint16_t>(generator());
+        }
 
-                case 0x2:
-                    op_8XY2(chip8, n2, n3);
-                    break;
+        chip8.memory[address] = static_cast<std::uint8_t>(opcode >> 8);
+        chip8.memory[address + 1] = static_cast<std::uint8_t>(opcode & 0xFF);
+    }
 
-                case 0x3:
-                    op_8XY3(chip8, n2, n3);
-                    break;
+    for (std::size_t key{0}; key < chip8.keys.size(); key++)
+    {
+        chip8.keys[key] = generator() % 3 == 0 ? 0x1 : 0x0;
+    }
+}
 
-                case 0x4:
-                    op_8XY4(chip8, n2, n3);
-                    break;
+template <typename Quirks>
+bool step(Chip8 &chip8)
+{
+    // The last memory byte can't hold a full opcode without wrapping around
+    if (chip8.pc >= ADDRESS_MASK)
+    {
+        if (!chip8.wrap_memory)
+        {
+            if (chip8.fault.kind == FaultKind::None)
+            {
+                chip8.fault = {FaultKind::MemoryOutOfRange, chip8.pc, 0};
+            }
+            return false;
+        }
+        chip8.pc &= ADDRESS_MASK;
+    }
 
-                case 0x5:
-                    op_8XY5(chip8, n2, n3);
-                    break;
+    std::uint16_t opcode = memory_byte(chip8, chip8.pc) << 8 | memory_byte(chip8, chip8.pc + 1);
+    chip8.pc += 2;
 
-                case 0x6:
-                    op_8XY6(chip8, n2, n3);
-                    break;
+    return execute<Quirks>(chip8, opcode);
+}
 
-                case 0x7:
-                    op_8XY7(chip8, n2, n3);
-                    break;
+bool step(Chip8 &chip8)
+{
+    return with_quirk_profile(quirk_profile(chip8), [&chip8](auto quirks) { return step<decltype(quirks)>(chip8); });
+}
 
-                case 0xE:
-                    op_8XYE(chip8, n2, n3);
-                    break;
+void tick_timers(Chip8 &chip8)
+{
+    if (chip8.delay_timer > 0)
+    {
+        chip8.delay_timer--;
+    }
 
-                default:
-                    std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                    return false;
-            }
-            break;
+    if (chip8.sound_timer > 0)
+    {
+        chip8.sound_timer--;
+    }
+}
 
-        // 9XY0
-        case 0x9:
-            if (n4 != 0x0)
-            {
-                std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                return false;
-            }
+bool at_frame_wait(const Chip8 &chip8)
+{
+    if (chip8.dirty_rows == 0)
+    {
+        return false;
+    }
 
-            op_9XY0(chip8, n2, n3);
-            break;
+    const std::uint16_t opcode{static_cast<std::uint16_t>(chip8.memory[chip8.pc & ADDRESS_MASK] << 8 |
+                                                          chip8.memory[(chip8.pc + 1) & ADDRESS_MASK])};
+    const std::uint16_t wait{static_cast<std::uint16_t>(opcode & 0xF0FF)};
+    return wait == 0xF007 || wait == 0xF00A;
+}
 
-        // ANNN
-        case 0xA:
+template <typename Quirks>
+bool execute(Chip8 &chip8, const std::uint16_t opcode)
+{
+#ifdef CHIP8_ENABLE_STATS
+    record_instruction(static_cast<std::uint16_t>(chip8.pc - 2), opcode);
+#endif
+
+    // Decoded at compile time, a single dense switch turns into one jump through a table. Instructions that can fault
+    // record it in chip8.fault and are the only ones checking it afterwards
+    const OpcodeEntry &entry{opcode_entry(opcode)};
+    const std::uint8_t x{entry.x};
+    const std::uint8_t y{entry.y};
+
+    switch (entry.handler)
+    {
+        case OpcodeHandler::Op00E0:
+            op_00E0(chip8);
+            break;
+        case OpcodeHandler::Op00EE:
+            op_00EE(chip8);
+            return chip8.fault.kind == FaultKind::None;
+        case OpcodeHandler::Op1NNN:
+            op_1NNN(chip8, opcode);
+            break;
+        case OpcodeHandler::Op2NNN:
+            op_2NNN(chip8, opcode);
+            return chip8.fault.kind == FaultKind::None;
+        case OpcodeHandler::Op3XNN:
+            op_3XNN(chip8, opcode, x);
+            break;
+        case OpcodeHandler::Op4XNN:
+            op_4XNN(chip8, opcode, x);
+            break;
+        case OpcodeHandler::Op5XY0:
+            op_5XY0(chip8, x, y);
+            break;
+        case OpcodeHandler::Op6XNN:
+            op_6XNN(chip8, opcode, x);
+            break;
+        case OpcodeHandler::Op7XNN:
+            op_7XNN(chip8, opcode, x);
+            break;
+        case OpcodeHandler::Op8XY0:
+            op_8XY0(chip8, x, y);
+            break;
+        case OpcodeHandler::Op8XY1:
+            op_8XY1<Quirks>(chip8, x, y);
+            break;
+        case OpcodeHandler::Op8XY2:
+            op_8XY2<Quirks>(chip8, x, y);
+            break;
+        case OpcodeHandler::Op8XY3:
+            op_8XY3<Quirks>(chip8, x, y);
+            break;
+        case OpcodeHandler::Op8XY4:
+            op_8XY4(chip8, x, y);
+            break;
+        case OpcodeHandler::Op8XY5:
+            op_8XY5(chip8, x, y);
+            break;
+        case OpcodeHandler::Op8XY6:
+            op_8XY6<Quirks>(chip8, x, y);
+            break;
+        case OpcodeHandler::Op8XY7:
+            op_8XY7(chip8, x, y);
+            break;
+        case OpcodeHandler::Op8XYE:
+            op_8XYE<Quirks>(chip8, x, y);
+            break;
+        case OpcodeHandler::Op9XY0:
+            op_9XY0(chip8, x, y);
+            break;
+        case OpcodeHandler::OpANNN:
             op_ANNN(chip8, opcode);
             break;
-
-        // BNNN / BXNN
-        case 0xB:
-            op_BNNN(chip8, opcode, n2);
+        case OpcodeHandler::OpBNNN:
+            op_BNNN<Quirks>(chip8, opcode, x);
             break;
-
-        // CXNN
-        case 0xC:
-            op_CXNN(chip8, opcode, n2);
+        case OpcodeHandler::OpCXNN:
+            op_CXNN(chip8, opcode, x);
             break;
-
-        // DXYN
-        case 0xD:
-            op_DXYN(chip8, opcode, n2, n3);
+        case OpcodeHandler::OpDXYN:
+            op_DXYN<Quirks>(chip8, opcode, x, y);
+            return chip8.fault.kind == FaultKind::None;
+        case OpcodeHandler::OpEX9E:
+            op_EX9E(chip8, x);
             break;
-
-        // EX9E, EXA1
-        case 0xE:
-            switch (n3)
-            {
-                case 0x9:
-                    if (n4 != 0xE)
-                    {
-                        std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                        return false;
-                    }
-
-                    op_EX9E(chip8, n2);
-                    break;
-
-                case 0xA:
-                    if (n4 != 0x1)
-                    {
-                        std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                        return false;
-                    }
-
-                    op_EXA1(chip8, n2);
-                    break;
-
-                default:
-                    std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                    return false;
-            }
+        case OpcodeHandler::OpEXA1:
+            op_EXA1(chip8, x);
             break;
-
-        // FX07, FX0A, FX15, FX18, FX1E, FX29, FX33, FX55, FX65
-        case 0xF:
-            switch (n3)
-            {
-                case 0x0:
-                    switch (n4)
-                    {
-                        case 0x7:
-                            op_FX07(chip8, n2);
-                            break;
-
-                        case 0xA:
-                            op_FX0A(chip8, n2);
-                            break;
-
-                        default:
-                            std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                            return false;
-                    }
-                    break;
-
-                case 0x1:
-                    switch (n4)
-                    {
-                        case 0x5:
-                            op_FX15(chip8, n2);
-                            break;
-
-                        case 0x8:
-                            op_FX18(chip8, n2);
-                            break;
-
-                        case 0xE:
-                            op_FX1E(chip8, n2);
-                            break;
-
-                        default:
-                            std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                            return false;
-                    }
-                    break;
-
-                case 0x2:
-                    if (n4 != 0x9)
-                    {
-                        std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                        return false;
-                    }
-
-                    op_FX29(chip8, n2);
-                    break;
-
-                case 0x3:
-                    if (n4 != 0x3)
-                    {
-                        std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                        return false;
-                    }
-
-                    op_FX33(chip8, n2);
-                    break;
-
-                case 0x5:
-                    if (n4 != 0x5)
-                    {
-                        std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                        return false;
-                    }
-
-                    op_FX55(chip8, n2);
-                    break;
-
-                case 0x6:
-                    if (n4 != 0x5)
-                    {
-                        std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                        return false;
-                    }
-
-                    op_FX65(chip8, n2);
-                    break;
-
-                default:
-                    std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
-                    return false;
-            }
+        case OpcodeHandler::OpFX07:
+            op_FX07(chip8, x);
+            break;
+        case OpcodeHandler::OpFX0A:
+            op_FX0A<Quirks>(chip8, x);
+            break;
+        case OpcodeHandler::OpFX15:
+            op_FX15(chip8, x);
             break;
+        case OpcodeHandler::OpFX18:
+            op_FX18(chip8, x);
+            break;
+        case OpcodeHandler::OpFX1E:
+            op_FX1E<Quirks>(chip8, x);
+            break;
+        case OpcodeHandler::OpFX29:
+            op_FX29(chip8, x);
+            break;
+        case OpcodeHandler::OpFX33:
+            op_FX33(chip8, opcode, x);
+            return chip8.fault.kind == FaultKind::None;
+        case OpcodeHandler::OpFX55:
+            op_FX55<Quirks>(chip8, opcode, x);
+            return chip8.fault.kind == FaultKind::None;
+        case OpcodeHandler::OpFX65:
+            op_FX65<Quirks>(chip8, opcode, x);
+            return chip8.fault.kind == FaultKind::None;
+        // 0NNN is not implemented either
+        case OpcodeHandler::Invalid:
+            raise_fault(chip8, FaultKind::InvalidOpcode, opcode);
+            return false;
+    }
+    return true;
+}
 
-        default:
-            std::cerr << "Invalid instruction. Opcode: " << std::hex << opcode << std::endl;
+bool execute(Chip8 &chip8, const std::uint16_t opcode)
+{
+    return with_quirk_profile(quirk_profile(chip8),
+                              [&chip8, opcode](auto quirks) { return execute<decltype(quirks)>(chip8, opcode); });
+}
+
+#define INSTANTIATE_QUIRK_DISPATCH(Quirks)                                                                             \
+    template bool execute<Quirks>(Chip8 &, std::uint16_t);                                                             \
+    template bool step<Quirks>(Chip8 &);
+
+CHIP8_FOR_EACH_QUIRK_PROFILE(INSTANTIATE_QUIRK_DISPATCH)
+
+bool run_headless(Interpreter &interpreter,
+                  Chip8 &chip8,
+                  const std::uint64_t max_instructions,
+                  const std::uint64_t max_frames,
+                  const std::uint32_t cycle_frecuency,
+                  std::uint64_t &frames)
+{
+    // Carry the remainder so the average timer rate is exact
+    std::uint32_t cycle_remainder{0};
+    const std::uint64_t start{interpreter.executed()};
+    frames = 0;
+
+    while ((max_frames == 0 || frames < max_frames) &&
+           (max_instructions == 0 || interpreter.executed() - start < max_instructions))
+    {
+        cycle_remainder += cycle_frecuency;
+        std::uint64_t frame_cycles{cycle_remainder / TIMER_FREQUENCY};
+        cycle_remainder %= TIMER_FREQUENCY;
+
+        // A frame cut short by the instruction budget runs its instructions but neither ticks the timers nor counts
+        bool partial_frame{false};
+        if (max_instructions != 0 && max_instructions - (interpreter.executed() - start) < frame_cycles)
+        {
+            frame_cycles = max_instructions - (interpreter.executed() - start);
+            partial_frame = true;
+        }
+
+        if (!interpreter.run(frame_cycles))
+        {
             return false;
+        }
+
+        if (partial_frame)
+        {
+            break;
+        }
+
+        tick_timers(chip8);
+        frames++;
     }
+
     return true;
 }
@@ -1,26 +1,149 @@
 #ifndef EMULATOR_UTILS_HPP
 #define EMULATOR_UTILS_HPP
 
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "chip8.hpp"
+#include "input_log.hpp"
+#include "interpreter.hpp"
+#include "quirks.hpp"
+
+// When the GUI front end hands a finished frame to the display
+enum class PresentMode
+{
+    // The display as it is at the end of every 60Hz timer tick
+    Tick,
+    // The display as it was when the program last started waiting on a timer or key after drawing, falling back to
+    // Tick for programs that never wait
+    Draw,
+};
+
+// Execution settings shared by every front end
+struct ExecutionOptions
+{
+    Engine engine{Engine::Cached};
+    PresentMode present_mode{PresentMode::Tick};
+    // Mute all sound
+    bool mute{false};
+    // Length of the audio output buffer, shorter means lower beep latency but a higher risk of underruns
+    std::uint32_t audio_buffer_ms{20};
+    // Seed for the CXNN random numbers, a random one is picked when not given
+    std::optional<std::uint64_t> seed{};
+    // Where to write the execution counters as JSON once emulation ends, only in CHIP8_ENABLE_STATS builds
+    std::string stats_path{};
+    // Where to write the key transitions and timer ticks of the session once emulation ends
+    std::string record_path{};
+    // Recording to drive the session from instead of the keyboard, loaded by --replay
+    std::shared_ptr<const InputLog> replay{};
+};
+
+// A named combination of quirk settings, as selected on the command line of the batch tools
+struct QuirkSet
+{
+    std::string name{};
+    bool cosmac{false};
+    bool amiga{false};
+};
+
+// Parses a quirk set name: modern, cosmac, amiga or cosmac+amiga. Returns false if the name is unknown
+bool parse_quirk_set(const std::string &name, QuirkSet &quirk_set);
+
+// Every quirk set, in the order listed above
+std::vector<QuirkSet> all_quirk_sets();
+
+// Splits a comma separated list, or one with any other separator
+std::vector<std::string> split(const std::string &value, char separator);
+
+// Collects every .ch8 file below the directory as paths relative to it, sorted so the batch tools report them in the
+// same order between runs. Returns false if the directory can't be opened
+bool find_roms(const std::string &directory, std::vector<std::string> &roms);
+
+// Formats a hash as 16 hexadecimal digits, for the reports of the batch tools
+std::string hash_string(std::uint64_t hash);
 
 // Parses and handles the emulator arguments. Returns -1 on error, 0 on success,
 // and 1 if the --help option is encountered
 int parse_arguments(Chip8 &chip8,
+                    ExecutionOptions &execution_options,
                     int argc,
                     char *argv[],
                     std::string &rom_location,
                     std::uint32_t &cycle_frecuency,
                     std::uint32_t &window_scale);
 
+// Parses the option at argv[index] if it is shared by every front end (--cosmac, --amiga, --wrap-memory, --mute,
+// --engine, --seed, --present, --audio-buffer, --stats, --record, --replay), advancing index past its value if it
+// takes one. Returns -1 on error, 0 if the option is not recognized and 1 if it was parsed
+int parse_option(Chip8 &chip8, ExecutionOptions &execution_options, int argc, char *argv[], int &index);
+
+// Overrides the quirks, memory wrapping, seed, mute setting and instructions per second with the ones recorded in the
+// replayed log, if any, so options given alongside --replay can't make it diverge. Returns false if the options
+// conflict with the replay
+bool apply_replay_settings(Chip8 &chip8, ExecutionOptions &execution_options, std::uint32_t &cycle_frecuency);
+
+// Seeds the CXNN random numbers with the seed given in the options, or a random one. Returns the seed used
+std::uint64_t seed_random(Chip8 &chip8, const ExecutionOptions &execution_options);
+
 // Loads the font into memory, starting at address 0x050 and finishing at 0x09F
 void load_font(Chip8 &chip8);
 
 // Loads the .ch8 ROM file's contents into memory when given a path to it
 bool load_ROM(Chip8 &chip8, const std::string &rom_path);
 
-// Decodes the opcode's intruction and calls the corresponding execution function
+// Returns whether the display pixel at the given coordinates is lit
+bool get_pixel(const Chip8 &chip8, std::uint32_t x, std::uint32_t y);
+
+// Returns a 64-bit FNV-1a hash of the display contents, identical on every platform
+std::uint64_t framebuffer_hash(const Chip8 &chip8);
+
+// Writes the display contents to a plain PBM image file
+bool save_framebuffer(const Chip8 &chip8, const std::string &path);
+
+// Fills the program area with random instructions, biased towards valid ones, and presses random keys. The same seed
+// always gives the same program, for fuzzing the engines against each other
+void load_random_program(Chip8 &chip8, std::uint64_t seed);
+
+// Returns the fault kind as a single word, for the status columns of the batch tools
+const char *fault_name(FaultKind kind);
+
+// Describes the fault with its opcode and address, for error messages
+std::string fault_message(const Fault &fault);
+
+// Decodes the opcode's intruction and calls the corresponding execution function, with the quirks of the given
+// profile. Instantiated for every profile in quirks.hpp. Returns false if the instruction raised a fault
+template <typename Quirks>
+bool execute(Chip8 &chip8, const std::uint16_t opcode);
+
+// Same as above, with the profile matching the machine's quirk flags. Prefer the template in loops
 bool execute(Chip8 &chip8, const std::uint16_t opcode);
 
+// Fetches the opcode pointed to by the program counter, advances it and executes the instruction. Returns false if the
+// fetch or the instruction raised a fault
+template <typename Quirks>
+bool step(Chip8 &chip8);
+
+// Same as above, with the profile matching the machine's quirk flags. Prefer the template in loops
+bool step(Chip8 &chip8);
+
+// Decrements the delay and sound timers, meant to be called at 60Hz
+void tick_timers(Chip8 &chip8);
+
+// Returns whether the next instruction reads the delay timer (FX07) or waits for a key (FX0A) while the display has
+// changed since chip8.dirty_rows was last cleared, the point where a program has finished drawing a frame
+bool at_frame_wait(const Chip8 &chip8);
+
+// Runs the interpreter as fast as possible until max_instructions instructions or max_frames frames have run, 0 meaning
+// no limit. Timers tick in emulated time, once every cycle_frecuency / 60 instructions. The number of whole frames
+// run is stored in frames, a last frame cut short by max_instructions neither ticks the timers nor counts. Returns
+// false if a fault stopped execution, chip8.fault tells which
+bool run_headless(Interpreter &interpreter,
+                  Chip8 &chip8,
+                  std::uint64_t max_instructions,
+                  std::uint64_t max_frames,
+                  std::uint32_t cycle_frecuency,
+                  std::uint64_t &frames);
+
 #endif  // EMULATOR_UTILS_HPP
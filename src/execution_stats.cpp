@@ -0,0 +1,85 @@
+#include "execution_stats.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "opcode_table.hpp"
+
+#ifdef CHIP8_ENABLE_STATS
+thread_local ExecutionStats execution_stats{};
+#endif
+
+static_assert(OPCODE_FAMILY_COUNT == OPCODE_HANDLER_COUNT, "Opcode families must match the opcode handlers");
+
+namespace
+{
+const std::array<const char *, OPCODE_FAMILY_COUNT> OPCODE_FAMILY_NAMES{
+    "00E0", "00EE", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN", "8XY0", "8XY1", "8XY2",
+    "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE", "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E",
+    "EXA1", "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65", "invalid"};
+}  // namespace
+
+std::size_t opcode_family(const std::uint16_t opcode)
+{
+    // Families are numbered like the handlers, so every opcode execute() rejects is counted as invalid
+    return static_cast<std::size_t>(opcode_entry(opcode).handler);
+}
+
+const char *opcode_family_name(const std::size_t family)
+{
+    return family < OPCODE_FAMILY_COUNT ? OPCODE_FAMILY_NAMES[family] : "unknown";
+}
+
+bool save_execution_stats(const ExecutionStats &stats, const std::string &path)
+{
+    std::ofstream stats_file(path);
+
+    if (!stats_file)
+    {
+        std::cerr << "Failed to create the file. Path: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<std::uint16_t> hot_pcs{};
+    for (std::size_t pc{0}; pc < stats.pc_counts.size(); pc++)
+    {
+        if (stats.pc_counts[pc] != 0)
+        {
+            hot_pcs.push_back(static_cast<std::uint16_t>(pc));
+        }
+    }
+    std::stable_sort(hot_pcs.begin(),
+                     hot_pcs.end(),
+                     [&stats](const std::uint16_t a, const std::uint16_t b)
+                     { return stats.pc_counts[a] > stats.pc_counts[b]; });
+
+    stats_file << "{\n"
+               << "  \"instructions\": "
+               << std::accumulate(stats.opcode_counts.begin(), stats.opcode_counts.end(), std::uint64_t{0}) << ",\n"
+               << "  \"fx0a_wait_cycles\": " << stats.fx0a_wait_cycles << ",\n"
+               << "  \"dxyn_pixels\": " << stats.dxyn_pixels << ",\n"
+               << "  \"opcodes\": {";
+
+    for (std::size_t family{0}; family < OPCODE_FAMILY_COUNT; family++)
+    {
+        stats_file << (family == 0 ? "\n" : ",\n") << "    \"" << opcode_family_name(family)
+                   << "\": " << stats.opcode_counts[family];
+    }
+
+    stats_file << "\n  },\n"
+               << "  \"hot_pcs\": [";
+
+    for (std::size_t i{0}; i < hot_pcs.size(); i++)
+    {
+        stats_file << (i == 0 ? "\n" : ",\n") << "    {\"pc\": \"0x" << std::hex << std::setw(3) << std::setfill('0')
+                   << hot_pcs[i] << std::dec << "\", \"count\": " << stats.pc_counts[hot_pcs[i]] << "}";
+    }
+
+    stats_file << "\n  ]\n}\n";
+
+    return static_cast<bool>(stats_file);
+}
@@ -0,0 +1,65 @@
+#ifndef EXECUTION_STATS_HPP
+#define EXECUTION_STATS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Number of opcode families counted, from 00E0 to FX65 plus one for invalid opcodes
+const std::size_t OPCODE_FAMILY_COUNT{35};
+
+// Returns the family index of an opcode, OPCODE_FAMILY_COUNT - 1 if it is invalid
+std::size_t opcode_family(std::uint16_t opcode);
+
+// Returns the name of an opcode family, e.g. "8XY4"
+const char *opcode_family_name(std::size_t family);
+
+// Execution counters, only filled in when built with CHIP8_ENABLE_STATS
+struct ExecutionStats
+{
+    std::array<std::uint64_t, OPCODE_FAMILY_COUNT> opcode_counts{};
+    // Instructions executed at each address
+    std::array<std::uint64_t, 4096> pc_counts{};
+    // FX0A executions that found no key and kept waiting
+    std::uint64_t fx0a_wait_cycles{0};
+    // Sprite pixels drawn by DXYN, clipped ones excluded
+    std::uint64_t dxyn_pixels{0};
+};
+
+// Whether the counters are compiled in
+constexpr bool execution_stats_enabled()
+{
+#ifdef CHIP8_ENABLE_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef CHIP8_ENABLE_STATS
+// Counters of the instructions executed through execute() on the calling thread. Not defined at all in other
+// builds, so they don't carry the counters in every thread
+extern thread_local ExecutionStats execution_stats;
+
+// Counts one instruction, read at address pc
+inline void record_instruction(const std::uint16_t pc, const std::uint16_t opcode)
+{
+    execution_stats.opcode_counts[opcode_family(opcode)]++;
+    execution_stats.pc_counts[pc & 0xFFF]++;
+}
+
+// Counts the pixels set in a sprite row
+inline void record_sprite_row(std::uint64_t row)
+{
+    for (; row != 0; row &= row - 1)
+    {
+        execution_stats.dxyn_pixels++;
+    }
+}
+#endif
+
+// Writes the counters as JSON, with the hot addresses sorted by execution count. Returns false on failure
+bool save_execution_stats(const ExecutionStats &stats, const std::string &path);
+
+#endif  // EXECUTION_STATS_HPP
@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "emulator_utils.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace
+{
+const std::string FARM_USAGE{
+    "Usage: /path/to/chip8_farm /path/to/rom_directory<string> --output /path/to/results.json|.csv "
+    "--budgets <int,...>(optional, default 1000000) --quirks modern,cosmac,amiga,cosmac+amiga(optional, default all) "
+    "--threads <int>(optional) --frequency <int>(optional, default 700) --engine switch|cached|block|jit(optional) "
+    "--seed <int>(optional, default 0) --format json|csv(optional)"};
+
+struct FarmOptions
+{
+    std::string rom_directory{};
+    std::string output_location{};
+    std::string format{};
+    std::vector<std::uint64_t> budgets{};
+    std::vector<QuirkSet> quirk_sets{};
+    std::size_t threads{};
+    std::uint32_t cycle_frecuency{700};
+    Engine engine{Engine::Cached};
+    std::uint64_t seed{0};
+};
+
+struct FarmJob
+{
+    std::size_t rom{};
+    std::size_t quirk_set{};
+    std::uint64_t budget{};
+};
+
+struct FarmResult
+{
+    std::string status{};
+    std::string error{};
+    std::uint64_t instructions{};
+    std::uint64_t frames{};
+    std::uint64_t hash{};
+    double seconds{};
+};
+
+// Parses the farm arguments. Returns -1 on error, 0 on success, and 1 if the --help option is encountered
+int parse_farm_arguments(int argc, char *argv[], FarmOptions &options)
+{
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--help" || arg == "-h")
+        {
+            std::cout << "Runs every ROM in a directory under every quirk set and cycle budget, in parallel.\n"
+                      << FARM_USAGE << std::endl;
+            return 1;
+        }
+    }
+
+    if (argc < 2)
+    {
+        std::cerr << "Not enough arguments.\n" << FARM_USAGE << std::endl;
+        return -1;
+    }
+
+    options.rom_directory = argv[1];
+
+    for (int i{2}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << ".\n" << FARM_USAGE << std::endl;
+            return -1;
+        }
+
+        std::string value{argv[++i]};
+        try
+        {
+            if (arg == "--output")
+            {
+                options.output_location = value;
+            }
+            else if (arg == "--format")
+            {
+                options.format = value;
+            }
+            else if (arg == "--budgets")
+            {
+                options.budgets.clear();
+                for (const std::string &budget : split(value, ','))
+                {
+                    options.budgets.push_back(std::stoull(budget));
+                }
+            }
+            else if (arg == "--quirks")
+            {
+                options.quirk_sets.clear();
+                for (const std::string &name : split(value, ','))
+                {
+                    QuirkSet quirk_set{};
+                    if (!parse_quirk_set(name, quirk_set))
+                    {
+                        throw std::invalid_argument("Unknown quirk set.");
+                    }
+                    options.quirk_sets.push_back(quirk_set);
+                }
+            }
+            else if (arg == "--threads")
+            {
+                options.threads = std::stoul(value);
+            }
+            else if (arg == "--frequency")
+            {
+                options.cycle_frecuency = static_cast<std::uint32_t>(std::stoul(value));
+            }
+            else if (arg == "--engine")
+            {
+                if (!parse_engine(value, options.engine))
+                {
+                    throw std::invalid_argument("Unknown engine.");
+                }
+            }
+            else if (arg == "--seed")
+            {
+                options.seed = std::stoull(value, nullptr, 0);
+            }
+            else
+            {
+                std::cerr << "Unknown argument: " << arg << ".\n" << FARM_USAGE << std::endl;
+                return -1;
+            }
+        }
+        catch (std::logic_error &)
+        {
+            std::cerr << "Invalid " << arg << " argument.\n" << FARM_USAGE << std::endl;
+            return -1;
+        }
+    }
+
+    if (options.output_location.empty())
+    {
+        std::cerr << "Missing --output argument.\n" << FARM_USAGE << std::endl;
+        return -1;
+    }
+
+    if (options.format.empty())
+    {
+        options.format = std::filesystem::path(options.output_location).extension() == ".csv" ? "csv" : "json";
+    }
+
+    if (options.format != "json" && options.format != "csv")
+    {
+        std::cerr << "Invalid --format argument.\n" << FARM_USAGE << std::endl;
+        return -1;
+    }
+
+    if (options.budgets.empty())
+    {
+        options.budgets.push_back(1000000);
+    }
+
+    if (std::find(options.budgets.begin(), options.budgets.end(), 0) != options.budgets.end())
+    {
+        std::cerr << "Invalid --budgets argument.\n" << FARM_USAGE << std::endl;
+        return -1;
+    }
+
+    if (options.quirk_sets.empty())
+    {
+        options.quirk_sets = all_quirk_sets();
+    }
+
+    if (options.threads == 0)
+    {
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    if (options.cycle_frecuency == 0)
+    {
+        std::cerr << "Invalid --frequency argument.\n" << FARM_USAGE << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+FarmResult run_job(const FarmOptions &options, const std::string &rom, const QuirkSet &quirk_set, std::uint64_t budget)
+{
+    FarmResult result{};
+
+    const auto start{std::chrono::steady_clock::now()};
+
+    Chip8 chip8{};
+    chip8.cosmac = quirk_set.cosmac;
+    chip8.amiga = quirk_set.amiga;
+    chip8.random.seed(options.seed);
+
+    load_font(chip8);
+
+    if (!load_ROM(chip8, rom))
+    {
+        result.status = "load_failed";
+        return result;
+    }
+
+    chip8.pc = START_ADDRESS;
+
+    Interpreter interpreter(chip8, options.engine);
+
+    result.status = run_headless(interpreter, chip8, budget, 0, options.cycle_frecuency, result.frames)
+                        ? "ok"
+                        : fault_name(chip8.fault.kind);
+    if (chip8.fault.kind != FaultKind::None)
+    {
+        result.error = fault_message(chip8.fault);
+    }
+
+    result.instructions = interpreter.executed();
+    result.hash = framebuffer_hash(chip8);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return result;
+}
+
+std::string json_string(const std::string &value)
+{
+    std::string escaped{"\""};
+    for (const char character : value)
+    {
+        switch (character)
+        {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(character) < 0x20)
+                {
+                    char buffer[7]{};
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned char>(character));
+                    escaped += buffer;
+                }
+                else
+                {
+                    escaped += character;
+                }
+                break;
+        }
+    }
+
+    return escaped + "\"";
+}
+
+std::string csv_string(const std::string &value)
+{
+    if (value.find_first_of(",\"\n") == std::string::npos)
+    {
+        return value;
+    }
+
+    std::string escaped{"\""};
+    for (const char character : value)
+    {
+        escaped += character == '"' ? std::string("\"\"") : std::string(1, character);
+    }
+
+    return escaped + "\"";
+}
+
+bool save_results(const FarmOptions &options,
+                  const std::vector<std::string> &roms,
+                  const std::vector<FarmJob> &jobs,
+                  const std::vector<FarmResult> &results)
+{
+    std::ofstream results_file(options.output_location);
+
+    if (!results_file)
+    {
+        std::cerr << "Failed to create the file. Path: " << options.output_location << std::endl;
+        return false;
+    }
+
+    if (options.format == "csv")
+    {
+        results_file << "rom,quirks,cosmac,amiga,budget,status,instructions,frames,framebuffer_hash,seconds,error\n";
+        for (std::size_t i{0}; i < jobs.size(); i++)
+        {
+            const FarmJob &job{jobs[i]};
+            const QuirkSet &quirk_set{options.quirk_sets[job.quirk_set]};
+            const FarmResult &result{results[i]};
+
+            results_file << csv_string(roms[job.rom]) << ',' << quirk_set.name << ',' << quirk_set.cosmac << ','
+                         << quirk_set.amiga << ',' << job.budget << ',' << result.status << ','
+                         << result.instructions << ',' << result.frames << ',' << hash_string(result.hash) << ','
+                         << result.seconds << ',' << csv_string(result.error) << '\n';
+        }
+    }
+    else
+    {
+        results_file << "{\n"
+                     << "  \"engine\": " << json_string(engine_name(options.engine)) << ",\n"
+                     << "  \"frequency\": " << options.cycle_frecuency << ",\n"
+                     << "  \"seed\": " << options.seed << ",\n"
+                     << "  \"threads\": " << options.threads << ",\n"
+                     << "  \"runs\": [";
+
+        for (std::size_t i{0}; i < jobs.size(); i++)
+        {
+            const FarmJob &job{jobs[i]};
+            const QuirkSet &quirk_set{options.quirk_sets[job.quirk_set]};
+            const FarmResult &result{results[i]};
+
+            results_file << (i == 0 ? "\n" : ",\n") << "    {\"rom\": " << json_string(roms[job.rom])
+                         << ", \"quirks\": " << json_string(quirk_set.name)
+                         << ", \"cosmac\": " << (quirk_set.cosmac ? "true" : "false")
+                         << ", \"amiga\": " << (quirk_set.amiga ? "true" : "false") << ", \"budget\": " << job.budget
+                         << ", \"status\": " << json_string(result.status)
+                         << ", \"instructions\": " << result.instructions << ", \"frames\": " << result.frames
+                         << ", \"framebuffer_hash\": " << json_string(hash_string(result.hash))
+                         << ", \"seconds\": " << result.seconds << ", \"error\": " << json_string(result.error) << "}";
+        }
+
+        results_file << "\n  ]\n}\n";
+    }
+
+    return static_cast<bool>(results_file);
+}
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    FarmOptions options{};
+
+    switch (parse_farm_arguments(argc, argv, options))
+    {
+        case -1:
+            std::cerr << "Fatal error, execution aborted." << std::endl;
+            return EXIT_FAILURE;
+        case 1:
+            return EXIT_SUCCESS;
+        default:
+            break;
+    }
+
+    std::vector<std::string> roms{};
+    if (!find_roms(options.rom_directory, roms))
+    {
+        std::cerr << "Fatal error, execution aborted." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Results list the ROMs by their full path
+    for (std::string &rom : roms)
+    {
+        rom = (std::filesystem::path(options.rom_directory) / rom).string();
+    }
+
+    std::vector<FarmJob> jobs{};
+    for (std::size_t rom{0}; rom < roms.size(); rom++)
+    {
+        for (std::size_t quirk_set{0}; quirk_set < options.quirk_sets.size(); quirk_set++)
+        {
+            for (const std::uint64_t budget : options.budgets)
+            {
+                jobs.push_back({rom, quirk_set, budget});
+            }
+        }
+    }
+
+    // Every job writes only its own result, so no locking is needed
+    std::vector<FarmResult> results(jobs.size());
+
+    const auto start{std::chrono::steady_clock::now()};
+
+    run_work_stealing(jobs.size(),
+                      options.threads,
+                      [&](const std::size_t index)
+                      {
+                          const FarmJob &job{jobs[index]};
+                          results[index] =
+                              run_job(options, roms[job.rom], options.quirk_sets[job.quirk_set], job.budget);
+                      });
+
+    const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+
+    const std::size_t failures{static_cast<std::size_t>(
+        std::count_if(results.begin(), results.end(), [](const FarmResult &result) { return result.status != "ok"; }))};
+
+    std::cout << "roms: " << roms.size() << "\n"
+              << "runs: " << jobs.size() << "\n"
+              << "failures: " << failures << "\n"
+              << "threads: " << options.threads << "\n"
+              << "seconds: " << elapsed.count() << std::endl;
+
+    if (!save_results(options, roms, jobs, results))
+    {
+        std::cerr << "Fatal error, execution aborted." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
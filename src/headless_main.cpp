@@ -0,0 +1,243 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "emulator_utils.hpp"
+#include "execution_stats.hpp"
+
+namespace
+{
+const std::string HEADLESS_USAGE{
+    "Usage: /path/to/chip8_headless /path/to/rom<string> --instructions <int> | --frames <int> "
+    "--frequency <int>(optional, default 700) --output /path/to/image.pbm(optional) --cosmac(optional) "
+    "--amiga(optional) --wrap-memory(optional) --engine switch|cached|block|jit(optional) --seed <int>(optional) "
+    "--stats /path/to/stats.json(optional) "
+    "--replay /path/to/input.log(optional, replaces --instructions and --frames)"};
+
+struct HeadlessOptions
+{
+    std::string rom_location{};
+    std::string output_location{};
+    std::uint64_t instructions{};
+    std::uint64_t frames{};
+    std::uint32_t cycle_frecuency{700};
+};
+
+// Parses the headless runner arguments. Returns -1 on error, 0 on success, and 1 if the --help option is encountered
+int parse_headless_arguments(Chip8 &chip8,
+                             ExecutionOptions &execution_options,
+                             int argc,
+                             char *argv[],
+                             HeadlessOptions &options)
+{
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--help" || arg == "-h")
+        {
+            std::cout << "Runs a CHIP-8 ROM without a display, as fast as possible.\n" << HEADLESS_USAGE << std::endl;
+            return 1;
+        }
+    }
+
+    if (argc < 2)
+    {
+        std::cerr << "Not enough arguments.\n" << HEADLESS_USAGE << std::endl;
+        return -1;
+    }
+
+    options.rom_location = argv[1];
+
+    for (int i{2}; i < argc; i++)
+    {
+        switch (parse_option(chip8, execution_options, argc, argv, i))
+        {
+            case -1:
+                std::cerr << HEADLESS_USAGE << std::endl;
+                return -1;
+            case 1:
+                continue;
+            default:
+                break;
+        }
+
+        std::string arg{argv[i]};
+
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << ".\n" << HEADLESS_USAGE << std::endl;
+            return -1;
+        }
+
+        std::string value{argv[++i]};
+        try
+        {
+            if (arg == "--instructions")
+            {
+                options.instructions = std::stoull(value);
+            }
+            else if (arg == "--frames")
+            {
+                options.frames = std::stoull(value);
+            }
+            else if (arg == "--frequency")
+            {
+                options.cycle_frecuency = static_cast<std::uint32_t>(std::stoul(value));
+            }
+            else if (arg == "--output")
+            {
+                options.output_location = value;
+            }
+            else
+            {
+                std::cerr << "Unknown argument: " << arg << ".\n" << HEADLESS_USAGE << std::endl;
+                return -1;
+            }
+        }
+        catch (std::logic_error &)
+        {
+            std::cerr << "Invalid " << arg << " argument.\n" << HEADLESS_USAGE << std::endl;
+            return -1;
+        }
+    }
+
+    if (!execution_options.record_path.empty())
+    {
+        std::cerr << "--record needs the keyboard, it is only available in the emulator window.\n"
+                  << HEADLESS_USAGE << std::endl;
+        return -1;
+    }
+
+    if (execution_options.replay)
+    {
+        // The recording decides how long to run for
+        if (options.instructions != 0 || options.frames != 0)
+        {
+            std::cerr << "--replay runs until the end of the recording, --instructions and --frames can't be given.\n"
+                      << HEADLESS_USAGE << std::endl;
+            return -1;
+        }
+
+        apply_replay_settings(chip8, execution_options, options.cycle_frecuency);
+        return 0;
+    }
+
+    if ((options.instructions == 0) == (options.frames == 0))
+    {
+        std::cerr << "Exactly one of --instructions or --frames is required.\n" << HEADLESS_USAGE << std::endl;
+        return -1;
+    }
+
+    if (options.cycle_frecuency == 0)
+    {
+        std::cerr << "Invalid --frequency argument.\n" << HEADLESS_USAGE << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    Chip8 chip8{};
+    ExecutionOptions execution_options{};
+    HeadlessOptions options{};
+
+    switch (parse_headless_arguments(chip8, execution_options, argc, argv, options))
+    {
+        case -1:
+            std::cerr << "Fatal error, execution aborted." << std::endl;
+            return EXIT_FAILURE;
+        case 1:
+            return EXIT_SUCCESS;
+        default:
+            break;
+    }
+
+    load_font(chip8);
+    const std::uint64_t seed{seed_random(chip8, execution_options)};
+
+    if (!load_ROM(chip8, options.rom_location))
+    {
+        std::cerr << "Fatal error, execution aborted." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    chip8.pc = START_ADDRESS;
+
+    Interpreter interpreter(chip8, execution_options.engine);
+
+    std::uint64_t frames{0};
+
+    const auto start{std::chrono::steady_clock::now()};
+
+    bool failed{false};
+    if (execution_options.replay)
+    {
+        std::size_t next_event{0};
+        failed = !replay_input(
+            *execution_options.replay,
+            next_event,
+            chip8,
+            interpreter,
+            execution_options.replay->end_instruction,
+            [&interpreter](const std::uint64_t count) { return interpreter.run(count); },
+            [&chip8, &frames]()
+            {
+                tick_timers(chip8);
+                frames++;
+            });
+    }
+    else
+    {
+        failed =
+            !run_headless(interpreter, chip8, options.instructions, options.frames, options.cycle_frecuency, frames);
+    }
+
+    const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+
+    const std::uint64_t executed{interpreter.executed()};
+
+    std::cout << "engine: " << engine_name(interpreter.active_engine()) << "\n"
+              << "seed: " << seed << "\n"
+              << "instructions: " << executed << "\n"
+              << "idle_instructions: " << interpreter.idle_skipped() << "\n"
+              << "frames: " << frames << "\n"
+              << "seconds: " << elapsed.count() << "\n"
+              << "instructions_per_second: " << (elapsed.count() > 0.0 ? executed / elapsed.count() : 0.0)
+              << std::endl;
+
+    if (execution_options.replay)
+    {
+        const bool matches{executed == execution_options.replay->end_instruction &&
+                           framebuffer_hash(chip8) == execution_options.replay->end_hash};
+        std::cout << "replay: " << (matches ? "match" : "mismatch") << std::endl;
+        failed = failed || !matches;
+    }
+
+    if (!options.output_location.empty() && !save_framebuffer(chip8, options.output_location))
+    {
+        return EXIT_FAILURE;
+    }
+
+#ifdef CHIP8_ENABLE_STATS
+    if (!execution_options.stats_path.empty() && !save_execution_stats(execution_stats, execution_options.stats_path))
+    {
+        return EXIT_FAILURE;
+    }
+#endif
+
+    if (chip8.fault.kind != FaultKind::None)
+    {
+        std::cerr << fault_message(chip8.fault) << std::endl;
+    }
+
+    if (failed)
+    {
+        std::cerr << "Fatal error, execution aborted." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
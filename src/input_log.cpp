@@ -0,0 +1,147 @@
+#include "input_log.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+const std::string INPUT_LOG_HEADER{"chip8-input-log 1"};
+}  // namespace
+
+bool save_input_log(const InputLog &input_log, const std::string &path)
+{
+    std::ofstream log_file(path);
+
+    if (!log_file)
+    {
+        std::cerr << "Failed to create the file. Path: " << path << std::endl;
+        return false;
+    }
+
+    log_file << INPUT_LOG_HEADER << "\n"
+             << "seed " << input_log.seed << "\n"
+             << "cosmac " << input_log.cosmac << "\n"
+             << "amiga " << input_log.amiga << "\n"
+             << "wrap_memory " << input_log.wrap_memory << "\n"
+             << "mute " << input_log.mute << "\n"
+             << "frequency " << input_log.cycle_frecuency << "\n";
+
+    // "t count" for a timer tick, "k count key pressed" for a key transition
+    for (const InputEvent &event : input_log.events)
+    {
+        if (event.key == TIMER_TICK_EVENT)
+        {
+            log_file << "t " << event.instruction << "\n";
+        }
+        else
+        {
+            log_file << "k " << event.instruction << " " << static_cast<std::uint32_t>(event.key) << " "
+                     << event.pressed << "\n";
+        }
+    }
+
+    log_file << "end " << input_log.end_instruction << " " << std::hex << input_log.end_hash << std::dec << "\n";
+
+    return static_cast<bool>(log_file);
+}
+
+bool load_input_log(const std::string &path, InputLog &input_log)
+{
+    std::ifstream log_file(path);
+
+    if (!log_file)
+    {
+        std::cerr << "Failed to open the file. Path: " << path << std::endl;
+        return false;
+    }
+
+    std::string line{};
+    if (!std::getline(log_file, line) || line != INPUT_LOG_HEADER)
+    {
+        std::cerr << "Not an input log. Path: " << path << std::endl;
+        return false;
+    }
+
+    input_log = InputLog{};
+    bool ended{false};
+    std::uint64_t line_number{1};
+
+    while (std::getline(log_file, line))
+    {
+        line_number++;
+        std::istringstream fields(line);
+        std::string name{};
+        fields >> name;
+
+        bool valid{true};
+        if (name == "t")
+        {
+            InputEvent event{0, TIMER_TICK_EVENT, false};
+            valid = static_cast<bool>(fields >> event.instruction);
+            input_log.events.push_back(event);
+        }
+        else if (name == "k")
+        {
+            std::uint32_t key{};
+            InputEvent event{};
+            valid = static_cast<bool>(fields >> event.instruction >> key >> event.pressed) && key <= 0xF;
+            event.key = static_cast<std::uint8_t>(key);
+            input_log.events.push_back(event);
+        }
+        else if (name == "seed")
+        {
+            valid = static_cast<bool>(fields >> input_log.seed);
+        }
+        else if (name == "cosmac")
+        {
+            valid = static_cast<bool>(fields >> input_log.cosmac);
+        }
+        else if (name == "amiga")
+        {
+            valid = static_cast<bool>(fields >> input_log.amiga);
+        }
+        // Missing from logs recorded before wrap_memory existed, which always ran without it
+        else if (name == "wrap_memory")
+        {
+            valid = static_cast<bool>(fields >> input_log.wrap_memory);
+        }
+        else if (name == "mute")
+        {
+            valid = static_cast<bool>(fields >> input_log.mute);
+        }
+        else if (name == "frequency")
+        {
+            valid = static_cast<bool>(fields >> input_log.cycle_frecuency) && input_log.cycle_frecuency != 0;
+        }
+        else if (name == "end")
+        {
+            valid = static_cast<bool>(fields >> input_log.end_instruction >> std::hex >> input_log.end_hash);
+            ended = true;
+        }
+        else
+        {
+            valid = name.empty();
+        }
+
+        // Events must be in the order they were applied
+        if (valid && input_log.events.size() > 1)
+        {
+            valid = input_log.events.back().instruction >= input_log.events[input_log.events.size() - 2].instruction;
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Malformed input log at line " << line_number << ". Path: " << path << std::endl;
+            return false;
+        }
+    }
+
+    if (!ended)
+    {
+        std::cerr << "Input log ends early, the recording was cut short. Path: " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
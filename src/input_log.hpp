@@ -0,0 +1,97 @@
+#ifndef INPUT_LOG_HPP
+#define INPUT_LOG_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chip8.hpp"
+#include "interpreter.hpp"
+
+// Key value of the events that stand for a 60Hz timer tick rather than a key transition
+const std::uint8_t TIMER_TICK_EVENT{0xFF};
+
+// Something that happened to the machine from outside the program
+struct InputEvent
+{
+    // Instructions executed when the event was applied
+    std::uint64_t instruction{0};
+    // Key 0x0-0xF, or TIMER_TICK_EVENT
+    std::uint8_t key{0};
+    bool pressed{false};
+};
+
+// Everything needed to run a session again instruction for instruction: the settings it started with, every key
+// transition and timer tick tagged with the instruction count it was applied at, and how it ended
+struct InputLog
+{
+    std::uint64_t seed{0};
+    bool cosmac{false};
+    bool amiga{false};
+    bool wrap_memory{false};
+    bool mute{false};
+    std::uint32_t cycle_frecuency{700};
+    std::vector<InputEvent> events{};
+    // Instructions executed and framebuffer_hash() when the recording stopped
+    std::uint64_t end_instruction{0};
+    std::uint64_t end_hash{0};
+};
+
+// Writes the log as text, one event per line. Returns false on failure
+bool save_input_log(const InputLog &input_log, const std::string &path);
+
+// Reads a log written by save_input_log(). Returns false if the file can't be read or is malformed
+bool load_input_log(const std::string &path, InputLog &input_log);
+
+// Runs instructions until the interpreter has executed instruction_limit in total, applying the logged events due on
+// the way, starting at events[next_event]. Key transitions go straight to the keypad, and tick() is called for every
+// timer tick. run(count) must execute exactly count instructions through interpreter, returning false on failure,
+// which is passed on
+template <typename Run, typename Tick>
+bool replay_input(const InputLog &input_log,
+                  std::size_t &next_event,
+                  Chip8 &chip8,
+                  const Interpreter &interpreter,
+                  const std::uint64_t instruction_limit,
+                  Run run,
+                  Tick tick)
+{
+    while (true)
+    {
+        // Events recorded at the same count keep their order, so a tick and a key transition can't swap
+        for (; next_event < input_log.events.size() &&
+               input_log.events[next_event].instruction <= interpreter.executed();
+             next_event++)
+        {
+            const InputEvent &event{input_log.events[next_event]};
+            if (event.key == TIMER_TICK_EVENT)
+            {
+                tick();
+            }
+            else
+            {
+                chip8.keys[event.key & 0x0F] = event.pressed ? 0x1 : 0x0;
+            }
+        }
+
+        if (interpreter.executed() >= instruction_limit)
+        {
+            return true;
+        }
+
+        std::uint64_t stop{instruction_limit};
+        if (next_event < input_log.events.size())
+        {
+            stop = std::min(stop, input_log.events[next_event].instruction);
+        }
+
+        if (!run(stop - interpreter.executed()))
+        {
+            return false;
+        }
+    }
+}
+
+#endif  // INPUT_LOG_HPP
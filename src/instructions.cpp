@@ -1,20 +1,44 @@
 #include "instructions.hpp"
 
 #include <algorithm>
-#include <random>
 
 #include "chip8_constants.hpp"
+#include "execution_stats.hpp"
+#include "memory_access.hpp"
+
+namespace
+{
+// Whether the length bytes starting at the index register can be accessed, either because they fit in memory or
+// because the machine wraps around. Checked once per instruction, never per byte
+bool index_range_valid(const Chip8 &chip8, const std::uint32_t length)
+{
+    return chip8.wrap_memory || memory_range_valid(chip8.index_register, length);
+}
+}  // namespace
+
+void raise_fault(Chip8 &chip8, const FaultKind kind, const std::uint16_t opcode)
+{
+    if (chip8.fault.kind == FaultKind::None)
+    {
+        chip8.fault = {kind, static_cast<std::uint16_t>(chip8.pc - 2), opcode};
+    }
+}
 
 void op_00E0(Chip8 &chip8)
 {
     std::fill(chip8.display.begin(), chip8.display.end(), 0);
-    chip8.render = true;
+    chip8.dirty_rows = 0xFFFFFFFF;
 }
 
 void op_00EE(Chip8 &chip8)
 {
-    chip8.pc = chip8.stack.top();
-    chip8.stack.pop();
+    if (chip8.stack_pointer == 0)
+    {
+        raise_fault(chip8, FaultKind::StackUnderflow, 0x00EE);
+        return;
+    }
+
+    chip8.pc = chip8.stack[--chip8.stack_pointer];
 }
 
 void op_1NNN(Chip8 &chip8, const std::uint16_t opcode)
@@ -24,13 +48,19 @@ void op_1NNN(Chip8 &chip8, const std::uint16_t opcode)
 
 void op_2NNN(Chip8 &chip8, const std::uint16_t opcode)
 {
-    chip8.stack.push(chip8.pc);
+    if (chip8.stack_pointer >= STACK_SIZE)
+    {
+        raise_fault(chip8, FaultKind::StackOverflow, opcode);
+        return;
+    }
+
+    chip8.stack[chip8.stack_pointer++] = chip8.pc;
     chip8.pc = opcode & 0x0FFF;
 }
 
 void op_3XNN(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2)
 {
-    if (chip8.registers.at(n2) == (opcode & 0x00FF))
+    if (chip8.registers[n2] == (opcode & 0x00FF))
     {
         chip8.pc += 2;
     }
@@ -38,7 +68,7 @@ void op_3XNN(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2)
 
 void op_4XNN(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2)
 {
-    if (chip8.registers.at(n2) != (opcode & 0x00FF))
+    if (chip8.registers[n2] != (opcode & 0x00FF))
     {
         chip8.pc += 2;
     }
@@ -46,7 +76,7 @@ void op_4XNN(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2)
 
 void op_5XY0(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 {
-    if (chip8.registers.at(n2) == chip8.registers.at(n3))
+    if (chip8.registers[n2] == chip8.registers[n3])
     {
         chip8.pc += 2;
     }
@@ -54,125 +84,130 @@ void op_5XY0(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 
 void op_6XNN(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2)
 {
-    chip8.registers.at(n2) = opcode & 0x00FF;
+    chip8.registers[n2] = opcode & 0x00FF;
 }
 
 void op_7XNN(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2)
 {
-    chip8.registers.at(n2) += opcode & 0x00FF;
+    chip8.registers[n2] += opcode & 0x00FF;
 }
 
 void op_8XY0(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 {
-    chip8.registers.at(n2) = chip8.registers.at(n3);
+    chip8.registers[n2] = chip8.registers[n3];
 }
 
+template <typename Quirks>
 void op_8XY1(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 {
-    chip8.registers.at(n2) |= chip8.registers.at(n3);
+    chip8.registers[n2] |= chip8.registers[n3];
 
-    if (chip8.cosmac)
+    if constexpr (Quirks::logic_resets_vf)
     {
-        chip8.registers.at(0xF) = 0x0;
+        chip8.registers[0xF] = 0x0;
     }
 }
 
+template <typename Quirks>
 void op_8XY2(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 {
-    chip8.registers.at(n2) &= chip8.registers.at(n3);
+    chip8.registers[n2] &= chip8.registers[n3];
 
-    if (chip8.cosmac)
+    if constexpr (Quirks::logic_resets_vf)
     {
-        chip8.registers.at(0xF) = 0x0;
+        chip8.registers[0xF] = 0x0;
     }
 }
 
+template <typename Quirks>
 void op_8XY3(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 {
-    chip8.registers.at(n2) ^= chip8.registers.at(n3);
+    chip8.registers[n2] ^= chip8.registers[n3];
 
-    if (chip8.cosmac)
+    if constexpr (Quirks::logic_resets_vf)
     {
-        chip8.registers.at(0xF) = 0x0;
+        chip8.registers[0xF] = 0x0;
     }
 }
 
 void op_8XY4(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 {
-    std::uint16_t sum{static_cast<std::uint16_t>(chip8.registers.at(n2) + chip8.registers.at(n3))};
+    std::uint16_t sum{static_cast<std::uint16_t>(chip8.registers[n2] + chip8.registers[n3])};
 
-    chip8.registers.at(n2) = static_cast<std::uint8_t>(sum & 0xFF);
+    chip8.registers[n2] = static_cast<std::uint8_t>(sum & 0xFF);
 
     if (sum > 0xFF)
     {
-        chip8.registers.at(0xF) = 0x1;
+        chip8.registers[0xF] = 0x1;
     }
     else
     {
-        chip8.registers.at(0xF) = 0x0;
+        chip8.registers[0xF] = 0x0;
     }
 }
 
 void op_8XY5(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 {
-    std::uint8_t v_x{chip8.registers.at(n2)}, v_y{chip8.registers.at(n3)};
+    std::uint8_t v_x{chip8.registers[n2]}, v_y{chip8.registers[n3]};
 
-    chip8.registers.at(n2) = v_x - v_y;
+    chip8.registers[n2] = v_x - v_y;
 
     if (v_x >= v_y)
     {
-        chip8.registers.at(0xF) = 0x1;
+        chip8.registers[0xF] = 0x1;
     }
     else
     {
-        chip8.registers.at(0xF) = 0x0;
+        chip8.registers[0xF] = 0x0;
     }
 }
 
+template <typename Quirks>
 void op_8XY6(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 {
-    if (chip8.cosmac)
+    if constexpr (Quirks::shift_reads_vy)
     {
-        chip8.registers.at(n2) = chip8.registers.at(n3);
+        chip8.registers[n2] = chip8.registers[n3];
     }
 
-    std::uint8_t v_x{chip8.registers.at(n2)};
-    chip8.registers.at(n2) >>= 0x1;
-    chip8.registers.at(0xF) = v_x & 0x1;
+    std::uint8_t v_x{chip8.registers[n2]};
+    chip8.registers[n2] >>= 0x1;
+    chip8.registers[0xF] = v_x & 0x1;
 }
 
 void op_8XY7(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 {
-    std::uint8_t v_x{chip8.registers.at(n2)}, v_y{chip8.registers.at(n3)};
+    std::uint8_t v_x{chip8.registers[n2]}, v_y{chip8.registers[n3]};
 
-    chip8.registers.at(n2) = v_y - v_x;
+    chip8.registers[n2] = v_y - v_x;
 
     if (v_y >= v_x)
     {
-        chip8.registers.at(0xF) = 0x1;
+        chip8.registers[0xF] = 0x1;
     }
     else
     {
-        chip8.registers.at(0xF) = 0x0;
+        chip8.registers[0xF] = 0x0;
     }
 }
 
+template <typename Quirks>
 void op_8XYE(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 {
-    if (chip8.cosmac)
+    if constexpr (Quirks::shift_reads_vy)
     {
-        chip8.registers.at(n2) = chip8.registers.at(n3);
+        chip8.registers[n2] = chip8.registers[n3];
     }
 
-    std::uint8_t v_x{chip8.registers.at(n2)};
+    std::uint8_t v_x{chip8.registers[n2]};
 
-    chip8.registers.at(n2) <<= 0x1;
-    chip8.registers.at(0xF) = (v_x & 0x80) >> 0x7;
+    chip8.registers[n2] <<= 0x1;
+    chip8.registers[0xF] = (v_x & 0x80) >> 0x7;
 }
 
 void op_9XY0(Chip8 &chip8, const std::uint8_t n2, const std::uint8_t n3)
 {
-    if (chip8.registers.at(n2) != chip8.registers.at(n3))
+    if (chip8.registers[n2] != chip8.registers[n3])
     {
         chip8.pc += 2;
     }
@@ -183,70 +218,75 @@ void op_ANNN(Chip8 &chip8, const std::uint16_t opcode)
     chip8.index_register = opcode & 0x0FFF;
 }
 
+template <typename Quirks>
 void op_BNNN(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2)
 {
     // BNNN
-    if (chip8.cosmac)
+    if constexpr (Quirks::jump_reads_v0)
     {
-        chip8.pc = (opcode & 0x0FFF) + chip8.registers.at(0x0);
+        chip8.pc = (opcode & 0x0FFF) + chip8.registers[0x0];
     }
     // BXNN
     else
     {
-        chip8.pc = (opcode & 0x0FFF) + chip8.registers.at(n2);
+        chip8.pc = (opcode & 0x0FFF) + chip8.registers[n2];
     }
 }
 
 void op_CXNN(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2)
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distr(0x0, 0xFF);
-
-    chip8.registers.at(n2) = distr(gen) & (opcode & 0x00FF);
+    chip8.registers[n2] = chip8.random.next() & (opcode & 0x00FF);
 }
 
+template <typename Quirks>
 void op_DXYN(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2, const std::uint8_t n3)
 {
-    const std::uint8_t x_ini{static_cast<std::uint8_t>(chip8.registers.at(n2) % WINDOW_WIDTH)};
-    const std::uint8_t y_ini{static_cast<std::uint8_t>(chip8.registers.at(n3) % WINDOW_HEIGHT)};
-    const std::uint8_t height{static_cast<std::uint8_t>(opcode & 0x000F)};
+    const std::uint32_t x_ini{chip8.registers[n2] % WINDOW_WIDTH};
+    const std::uint32_t y_ini{chip8.registers[n3] % WINDOW_HEIGHT};
+    // Clipping profiles never read the rows below the bottom edge
+    const std::uint32_t height{Quirks::clip_sprites ? std::min<std::uint32_t>(opcode & 0x000Fu, WINDOW_HEIGHT - y_ini)
+                                                    : opcode & 0x000Fu};
 
-    // VF set to 0 if no pixels are turned off
-    chip8.registers.at(0xF) = 0x0;
+    if (!index_range_valid(chip8, height))
+    {
+        raise_fault(chip8, FaultKind::MemoryOutOfRange, opcode);
+        return;
+    }
+
+    // VF set to 1 if any pixels are turned off, 0 otherwise
+    bool collision{false};
 
     for (std::uint32_t y{0}; y < height; y++)
     {
-        std::uint8_t sprite_data{chip8.memory.at(chip8.index_register + y)};
+        const std::uint32_t display_y{y_ini + y};
 
-        // x from 0 to 7 since sprites are always 8 pixels wide
-        for (std::uint32_t x{0}; x < 8; x++)
-        {
-            std::uint8_t sprite_bit{static_cast<std::uint8_t>((sprite_data >> (7 - x)) & 0x1)};
-            std::uint32_t display_x{(x_ini + x)};
-            std::uint32_t display_y{(y_ini + y)};
+        // Sprites are 8 pixels wide, place the row on the leftmost pixels and move it to x_ini. Clipping profiles drop
+        // the pixels past the right edge, the rest wrap them around to the left
+        const std::uint64_t sprite_data{static_cast<std::uint64_t>(memory_byte(chip8, chip8.index_register + y)) << 56};
+        const std::uint64_t sprite_row{Quirks::clip_sprites || x_ini == 0
+                                           ? sprite_data >> x_ini
+                                           : sprite_data >> x_ini | sprite_data << (WINDOW_WIDTH - x_ini)};
 
-            if (!chip8.cosmac || (display_x < WINDOW_WIDTH && display_y < WINDOW_HEIGHT))
-            {
-                std::uint32_t display_index{(display_x % WINDOW_WIDTH) + (display_y % WINDOW_HEIGHT) * WINDOW_WIDTH};
-                if (sprite_bit)
-                {
-                    if (chip8.registers.at(0xF) == 0x0 && chip8.display.at(display_index) == 0xFFFFFFFF)
-                    {
-                        // VF set to 1 if any pixels are turned off
-                        chip8.registers.at(0xF) = 0x1;
-                    }
-                    chip8.display.at(display_index) ^= 0xFFFFFFFF;
-                }
-            }
+        std::uint64_t &display_row{chip8.display[display_y % WINDOW_HEIGHT]};
+        collision |= (display_row & sprite_row) != 0;
+        display_row ^= sprite_row;
+
+#ifdef CHIP8_ENABLE_STATS
+        record_sprite_row(sprite_row);
+#endif
+
+        if (sprite_row != 0)
+        {
+            chip8.dirty_rows |= 1u << (display_y % WINDOW_HEIGHT);
         }
     }
-    chip8.render = true;
+
+    chip8.registers[0xF] = collision ? 0x1 : 0x0;
 }
 
 void op_EX9E(Chip8 &chip8, const std::uint8_t n2)
 {
-    if (chip8.keys.at(chip8.registers.at(n2) & 0x0F) == 0x1)
+    if (chip8.keys[chip8.registers[n2] & 0x0F] == 0x1)
     {
         chip8.pc += 2;
     }
@@ -254,7 +294,7 @@ void op_EX9E(Chip8 &chip8, const std::uint8_t n2)
 
 void op_EXA1(Chip8 &chip8, const std::uint8_t n2)
 {
-    if (chip8.keys.at(chip8.registers.at(n2) & 0x0F) == 0x0)
+    if (chip8.keys[chip8.registers[n2] & 0x0F] == 0x0)
     {
         chip8.pc += 2;
     }
@@ -262,16 +302,17 @@ void op_EXA1(Chip8 &chip8, const std::uint8_t n2)
 
 void op_FX07(Chip8 &chip8, const std::uint8_t n2)
 {
-    chip8.registers.at(n2) = chip8.delay_timer;
+    chip8.registers[n2] = chip8.delay_timer;
 }
 
+template <typename Quirks>
 void op_FX0A(Chip8 &chip8, const std::uint8_t n2)
 {
-    if (chip8.cosmac && chip8.key_pressed != -1)
+    if constexpr (Quirks::wait_for_release)
     {
-        if (chip8.keys.at(chip8.key_pressed) == 0x0)
+        if (chip8.key_pressed != -1 && chip8.keys[chip8.key_pressed] == 0x0)
         {
-            chip8.registers.at(n2) = static_cast<uint8_t>(chip8.key_pressed);
+            chip8.registers[n2] = static_cast<uint8_t>(chip8.key_pressed);
             chip8.key_pressed = -1;
             return;
         }
@@ -279,43 +320,47 @@ void op_FX0A(Chip8 &chip8, const std::uint8_t n2)
 
     for (std::uint8_t i{0}; chip8.key_pressed == -1 && i < chip8.keys.size(); i++)
     {
-        if (chip8.keys.at(i) == 0x1)
+        if (chip8.keys[i] == 0x1)
         {
-            if (chip8.cosmac)
+            if constexpr (!Quirks::wait_for_release)
             {
-                chip8.key_pressed = i;
+                chip8.registers[n2] = i;
+                return;
             }
-            else
-            {
-                chip8.registers.at(n2) = i;
-            }
-            return;
+
+            // The COSMAC VIP keeps waiting until the key is released
+            chip8.key_pressed = static_cast<std::int8_t>(i);
         }
     }
 
+#ifdef CHIP8_ENABLE_STATS
+    execution_stats.fx0a_wait_cycles++;
+#endif
+
     chip8.pc -= 2;
 }
 
 void op_FX15(Chip8 &chip8, const std::uint8_t n2)
 {
-    chip8.delay_timer = chip8.registers.at(n2);
+    chip8.delay_timer = chip8.registers[n2];
 }
 
 void op_FX18(Chip8 &chip8, const std::uint8_t n2)
 {
-    chip8.sound_timer = chip8.registers.at(n2);
+    chip8.sound_timer = chip8.registers[n2];
 }
 
+template <typename Quirks>
 void op_FX1E(Chip8 &chip8, const std::uint8_t n2)
 {
-    std::uint16_t sum{static_cast<std::uint16_t>(chip8.index_register + chip8.registers.at(n2))};
+    std::uint16_t sum{static_cast<std::uint16_t>(chip8.index_register + chip8.registers[n2])};
 
     if (sum > 0x0FFF)
     {
         chip8.index_register = 0x0FFF;
-        if (chip8.amiga)
+        if constexpr (Quirks::index_overflow_sets_vf)
         {
-            chip8.registers.at(0xF) = 0x1;
+            chip8.registers[0xF] = 0x1;
         }
     }
     else
@@ -326,44 +371,79 @@ void op_FX1E(Chip8 &chip8, const std::uint8_t n2)
 
 void op_FX29(Chip8 &chip8, const std::uint8_t n2)
 {
-    chip8.index_register = FONT_ADDRESS + ((chip8.registers.at(n2) & 0x0F) * 0x5);
+    chip8.index_register = FONT_ADDRESS + ((chip8.registers[n2] & 0x0F) * 0x5);
 }
 
-void op_FX33(Chip8 &chip8, const std::uint8_t n2)
+void op_FX33(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2)
 {
-    std::uint8_t val{chip8.registers.at(n2)};
+    if (!index_range_valid(chip8, 3))
+    {
+        raise_fault(chip8, FaultKind::MemoryOutOfRange, opcode);
+        return;
+    }
+
+    std::uint8_t val{chip8.registers[n2]};
 
-    chip8.memory.at(chip8.index_register + 0x2) = val % 10;
+    memory_byte(chip8, chip8.index_register + 0x2) = val % 10;
     val /= 10;
 
-    chip8.memory.at(chip8.index_register + 0x1) = val % 10;
+    memory_byte(chip8, chip8.index_register + 0x1) = val % 10;
     val /= 10;
 
-    chip8.memory.at(chip8.index_register) = val % 10;
+    memory_byte(chip8, chip8.index_register) = val % 10;
 }
 
-void op_FX55(Chip8 &chip8, const std::uint8_t n2)
+template <typename Quirks>
+void op_FX55(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2)
 {
+    if (!index_range_valid(chip8, n2 + 1u))
+    {
+        raise_fault(chip8, FaultKind::MemoryOutOfRange, opcode);
+        return;
+    }
+
     for (std::uint8_t i{0}; i <= n2; i++)
     {
-        chip8.memory.at(chip8.index_register + i) = chip8.registers.at(i);
+        memory_byte(chip8, chip8.index_register + i) = chip8.registers[i];
     }
 
-    if (chip8.cosmac)
+    if constexpr (Quirks::load_store_increments_index)
     {
         chip8.index_register = (chip8.index_register + n2 + 1) & 0x0FFF;
     }
 }
 
-void op_FX65(Chip8 &chip8, const std::uint8_t n2)
+template <typename Quirks>
+void op_FX65(Chip8 &chip8, const std::uint16_t opcode, const std::uint8_t n2)
 {
+    if (!index_range_valid(chip8, n2 + 1u))
+    {
+        raise_fault(chip8, FaultKind::MemoryOutOfRange, opcode);
+        return;
+    }
+
     for (std::uint8_t i{0}; i <= n2; i++)
     {
-        chip8.registers.at(i) = chip8.memory.at(chip8.index_register + i);
+        chip8.registers[i] = memory_byte(chip8, chip8.index_register + i);
     }
 
-    if (chip8.cosmac)
+    if constexpr (Quirks::load_store_increments_index)
     {
         chip8.index_register = (chip8.index_register + n2 + 1) & 0x0FFF;
     }
 }
+
+#define INSTANTIATE_QUIRK_HANDLERS(Quirks)                                                                             \
+    template void op_8XY1<Quirks>(Chip8 &, std::uint8_t, std::uint8_t);                                                \
+    template void op_8XY2<Quirks>(Chip8 &, std::uint8_t, std::uint8_t);                                                \
+    template void op_8XY3<Quirks>(Chip8 &, std::uint8_t, std::uint8_t);                                                \
+    template void op_8XY6<Quirks>(Chip8 &, std::uint8_t, std::uint8_t);                                                \
+    template void op_8XYE<Quirks>(Chip8 &, std::uint8_t, std::uint8_t);                                                \
+    template void op_BNNN<Quirks>(Chip8 &, std::uint16_t, std::uint8_t);                                               \
+    template void op_DXYN<Quirks>(Chip8 &, std::uint16_t, std::uint8_t, std::uint8_t);                                 \
+    template void op_FX0A<Quirks>(Chip8 &, std::uint8_t);                                                              \
+    template void op_FX1E<Quirks>(Chip8 &, std::uint8_t);                                                              \
+    template void op_FX55<Quirks>(Chip8 &, std::uint16_t, std::uint8_t);                                                              \
+    template void op_FX65<Quirks>(Chip8 &, std::uint16_t, std::uint8_t);
+
+CHIP8_FOR_EACH_QUIRK_PROFILE(INSTANTIATE_QUIRK_HANDLERS)
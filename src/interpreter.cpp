@@ -0,0 +1,281 @@
+#include "interpreter.hpp"
+
+#include <iostream>
+
+#include "emulator_utils.hpp"
+
+#ifndef CHIP8_ENABLE_STATS
+namespace
+{
+// Instructions in a delay timer wait loop: FX07, then 3XNN or 4XNN on VX, then a jump back to the FX07
+const std::uint64_t IDLE_LOOP_LENGTH{3};
+
+std::uint16_t opcode_at(const Chip8 &chip8, const std::uint32_t address)
+{
+    return static_cast<std::uint16_t>(chip8.memory[address] << 8 | chip8.memory[address + 1]);
+}
+
+// Returns whether a delay timer wait loop starts at address and, with the delay timer as it is, runs another
+// iteration. Such a loop only writes VX, always with the same value, so until the timer changes every iteration
+// leaves the machine exactly as the previous one did
+bool idle_loop_continues(const Chip8 &chip8, const std::uint32_t address)
+{
+    if (address + 2 * IDLE_LOOP_LENGTH > chip8.memory.size())
+    {
+        return false;
+    }
+
+    const std::uint16_t load{opcode_at(chip8, address)};
+    const std::uint16_t compare{opcode_at(chip8, address + 2)};
+    if ((load & 0xF0FF) != 0xF007 || (compare & 0x0F00) != (load & 0x0F00) ||
+        opcode_at(chip8, address + 4) != (0x1000 | address))
+    {
+        return false;
+    }
+
+    // The skip jumps over the jump back, leaving the loop
+    const std::uint8_t value{static_cast<std::uint8_t>(compare & 0x00FF)};
+    switch (compare >> 12)
+    {
+        case 0x3:
+            return chip8.delay_timer != value;
+        case 0x4:
+            return chip8.delay_timer == value;
+        default:
+            return false;
+    }
+}
+}  // namespace
+#endif
+
+bool parse_engine(const std::string &name, Engine &engine)
+{
+    if (name == "switch")
+    {
+        engine = Engine::Switch;
+    }
+    else if (name == "cached")
+    {
+        engine = Engine::Cached;
+    }
+    else if (name == "block")
+    {
+        engine = Engine::Block;
+    }
+    else if (name == "jit")
+    {
+        engine = Engine::Jit;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+const char *engine_name(const Engine engine)
+{
+    switch (engine)
+    {
+        case Engine::Switch:
+            return "switch";
+        case Engine::Cached:
+            return "cached";
+        case Engine::Block:
+            return "block";
+        case Engine::Jit:
+            return "jit";
+    }
+    return "unknown";
+}
+
+Interpreter::Interpreter(Chip8 &chip8, const Engine engine) :
+    chip8(chip8),
+    engine(engine),
+    quirks(quirk_profile(chip8))
+{
+#ifdef CHIP8_ENABLE_STATS
+    if (engine != Engine::Switch)
+    {
+        std::cerr << "Built with CHIP8_ENABLE_STATS, using the switch engine so every instruction is counted."
+                  << std::endl;
+        this->engine = Engine::Switch;
+        return;
+    }
+#endif
+#ifdef CHIP8_ENABLE_JIT
+    if (engine == Engine::Jit && !jit_cache.available())
+    {
+        std::cerr << "Executable memory unavailable, falling back to the switch engine." << std::endl;
+        this->engine = Engine::Switch;
+    }
+#else
+    if (engine == Engine::Jit)
+    {
+        std::cerr << "Built without the x86-64 recompiler, falling back to the switch engine." << std::endl;
+        this->engine = Engine::Switch;
+    }
+#endif
+}
+
+bool Interpreter::run(const std::uint64_t count)
+{
+    return execute(count, false);
+}
+
+bool Interpreter::run_until_frame_wait(const std::uint64_t count)
+{
+    return execute(count, true);
+}
+
+bool Interpreter::execute(const std::uint64_t count, const bool stop_at_frame_wait)
+{
+    // The only fault check outside the instructions that raise them, a faulted machine stays stopped until the fault
+    // is cleared
+    if (chip8.fault.kind != FaultKind::None)
+    {
+        return false;
+    }
+
+    // Decoded instructions and blocks hold the handlers of the profile they were made with
+    const QuirkProfile profile{quirk_profile(chip8)};
+    if (profile != quirks)
+    {
+        reset();
+        quirks = profile;
+    }
+
+    const auto run_engine{[this, profile, stop_at_frame_wait](const std::uint64_t engine_count)
+                          {
+                              return with_quirk_profile(
+                                  profile,
+                                  [this, engine_count, stop_at_frame_wait](auto profile_quirks)
+                                  {
+                                      using Quirks = decltype(profile_quirks);
+                                      return stop_at_frame_wait ? run_with_quirks<Quirks, true>(engine_count)
+                                                                : run_with_quirks<Quirks, false>(engine_count);
+                                  });
+                          }};
+
+#ifndef CHIP8_ENABLE_STATS
+    // Timers only tick between run() calls, so a program waiting on the delay timer keeps waiting until the end of
+    // this one. Once the program counter reaches the start of the wait loop, every full iteration left is skipped.
+    // Not in CHIP8_ENABLE_STATS builds, which count every instruction executed
+    std::uint64_t lead_in{count};
+    for (std::uint64_t offset{0}; offset < IDLE_LOOP_LENGTH; offset++)
+    {
+        if (chip8.pc >= 2 * offset && idle_loop_continues(chip8, chip8.pc - 2 * offset))
+        {
+            lead_in = (IDLE_LOOP_LENGTH - offset) % IDLE_LOOP_LENGTH;
+            break;
+        }
+    }
+
+    if (lead_in + IDLE_LOOP_LENGTH <= count)
+    {
+        if (!run_engine(lead_in))
+        {
+            return false;
+        }
+
+        // Stopped early in front of a finished frame, or about to
+        if (stop_at_frame_wait && at_frame_wait(chip8))
+        {
+            return true;
+        }
+
+        // The lead in may have left the loop, if the timer changed since the last value it read
+        std::uint64_t skipped{0};
+        if (idle_loop_continues(chip8, chip8.pc))
+        {
+            skipped = (count - lead_in) / IDLE_LOOP_LENGTH * IDLE_LOOP_LENGTH;
+            chip8.registers[chip8.memory[chip8.pc] & 0x0F] = chip8.delay_timer;
+            instruction_count += skipped;
+            idle_instruction_count += skipped;
+        }
+
+        return run_engine(count - lead_in - skipped);
+    }
+#endif
+
+    return run_engine(count);
+}
+
+template <typename Quirks, bool STOP_AT_FRAME_WAIT>
+bool Interpreter::run_with_quirks(const std::uint64_t count)
+{
+    switch (engine)
+    {
+        case Engine::Switch:
+            for (std::uint64_t i{0}; i < count; i++)
+            {
+                if constexpr (STOP_AT_FRAME_WAIT)
+                {
+                    if (at_frame_wait(chip8))
+                    {
+                        instruction_count += i;
+                        return true;
+                    }
+                }
+
+                if (!step<Quirks>(chip8))
+                {
+                    instruction_count += i;
+                    return false;
+                }
+            }
+            break;
+
+        case Engine::Cached:
+            for (std::uint64_t i{0}; i < count; i++)
+            {
+                if constexpr (STOP_AT_FRAME_WAIT)
+                {
+                    if (at_frame_wait(chip8))
+                    {
+                        instruction_count += i;
+                        return true;
+                    }
+                }
+
+                if (!cache.step<Quirks>(chip8))
+                {
+                    instruction_count += i;
+                    return false;
+                }
+            }
+            break;
+
+        case Engine::Block:
+        {
+            std::uint64_t executed{0};
+            const bool success{block_cache.run<Quirks>(chip8, count, STOP_AT_FRAME_WAIT, executed)};
+            instruction_count += executed;
+            return success;
+        }
+
+        case Engine::Jit:
+        {
+#ifdef CHIP8_ENABLE_JIT
+            std::uint64_t executed{0};
+            const bool success{jit_cache.run<Quirks>(chip8, count, STOP_AT_FRAME_WAIT, executed)};
+            instruction_count += executed;
+            return success;
+#else
+            break;
+#endif
+        }
+    }
+
+    instruction_count += count;
+    return true;
+}
+
+void Interpreter::reset()
+{
+    cache.clear();
+    block_cache.flush();
+#ifdef CHIP8_ENABLE_JIT
+    jit_cache.flush();
+#endif
+}
@@ -0,0 +1,95 @@
+#ifndef INTERPRETER_HPP
+#define INTERPRETER_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "block_cache.hpp"
+#include "chip8.hpp"
+#include "decode_cache.hpp"
+#include "quirks.hpp"
+
+#ifdef CHIP8_ENABLE_JIT
+#include "jit_x64.hpp"
+#endif
+
+// Available instruction execution strategies
+enum class Engine
+{
+    // Decode every instruction through execute()
+    Switch,
+    // Decode every memory address once through DecodeCache
+    Cached,
+    // Translate code into basic blocks with fused instruction pairs through BlockCache
+    Block,
+    // Compile hot blocks to x86-64 machine code through JitCache. Falls back to Switch when the recompiler isn't
+    // built in or executable memory is unavailable
+    Jit,
+};
+
+// Parses an engine name as given on the command line. Returns false if the name is unknown
+bool parse_engine(const std::string &name, Engine &engine);
+
+// Returns the command line name of an engine
+const char *engine_name(Engine engine);
+
+// Runs CHIP-8 instructions with the selected engine, specialized on the quirk profile matching the machine's flags.
+// The profile is picked once per run() call, never per instruction. Programs spinning on the delay timer are
+// fast-forwarded to the end of the call, which is where the caller ticks the timers
+class Interpreter
+{
+public:
+    Interpreter(Chip8 &chip8, Engine engine);
+
+    // Executes the given number of instructions. Returns false if a fault stopped execution, or the machine was already
+    // faulted, leaving the details in chip8.fault
+    bool run(std::uint64_t count);
+
+    // Same as run(), but stops early in front of the next instruction for which at_frame_wait() holds, executed()
+    // telling how many instructions ran. Blocks and compiled code never span such an instruction, so stopping costs
+    // nothing more than the check between them
+    bool run_until_frame_wait(std::uint64_t count);
+
+    // Must be called whenever memory is rewritten from outside the interpreter, e.g. after loading a ROM
+    void reset();
+
+    // The engine in use, which differs from the one requested when it had to fall back
+    Engine active_engine() const
+    {
+        return engine;
+    }
+
+    // Total number of instructions executed so far
+    std::uint64_t executed() const
+    {
+        return instruction_count;
+    }
+
+    // Instructions of delay timer wait loops skipped rather than executed, already counted by executed(). Skipping
+    // leaves the machine exactly as executing them would have
+    std::uint64_t idle_skipped() const
+    {
+        return idle_instruction_count;
+    }
+
+private:
+    Chip8 &chip8;
+    Engine engine;
+    DecodeCache cache;
+    BlockCache block_cache;
+#ifdef CHIP8_ENABLE_JIT
+    JitCache jit_cache;
+#endif
+    std::uint64_t instruction_count{0};
+    std::uint64_t idle_instruction_count{0};
+    // Profile the caches were filled with
+    QuirkProfile quirks;
+
+    bool execute(std::uint64_t count, bool stop_at_frame_wait);
+
+    // STOP_AT_FRAME_WAIT is a template argument so plain run() calls don't pay for the check between instructions
+    template <typename Quirks, bool STOP_AT_FRAME_WAIT>
+    bool run_with_quirks(std::uint64_t count);
+};
+
+#endif  // INTERPRETER_HPP
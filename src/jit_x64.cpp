@@ -0,0 +1,851 @@
+#include "jit_x64.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "decode_cache.hpp"
+#include "emulator_utils.hpp"
+
+namespace
+{
+const std::uint32_t MEMORY_SIZE{4096};
+
+// Pseudo register index used for I when allocating host registers
+const std::uint32_t INDEX_REGISTER{16};
+
+// x86-64 general purpose register numbers
+enum Register : std::uint8_t
+{
+    RAX = 0,
+    RCX = 1,
+    RDX = 2,
+    RBX = 3,
+    RSP = 4,
+    RBP = 5,
+    RSI = 6,
+    RDI = 7,
+    R8 = 8,
+    R9 = 9,
+    R10 = 10,
+    R11 = 11,
+    R12 = 12,
+    R13 = 13,
+    R14 = 14,
+    R15 = 15,
+};
+
+// Registers that can hold V registers and I. RAX and RCX are scratch, and RBP holds the Chip8 pointer
+const std::array<Register, 12> ALLOCATABLE{RBX, RDX, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15};
+
+// Registers preserved across calls by either the System V or the Windows x64 calling convention
+const std::array<Register, 8> SAVED{RBX, RBP, RSI, RDI, R12, R13, R14, R15};
+
+// Condition codes, shared by SETcc and CMOVcc
+enum Condition : std::uint8_t
+{
+    BELOW = 0x2,
+    NOT_BELOW = 0x3,
+    EQUAL = 0x4,
+    NOT_EQUAL = 0x5,
+    ABOVE = 0x7,
+};
+
+// ALU opcodes taking an 8-bit register destination and source
+enum ByteOperation : std::uint8_t
+{
+    ADD = 0x00,
+    OR = 0x08,
+    AND = 0x20,
+    SUB = 0x28,
+    XOR = 0x30,
+    CMP = 0x38,
+    MOV = 0x88,
+};
+
+// Minimal x86-64 encoder, only covering what the recompiler emits. Memory operands are always [rbp + disp32]
+class Emitter
+{
+public:
+    std::vector<std::uint8_t> code;
+
+    void byte_operation(const ByteOperation operation, const Register destination, const Register source)
+    {
+        rex_byte(source, destination);
+        emit(operation);
+        modrm(3, source, destination);
+    }
+
+    void mov8_imm(const Register destination, const std::uint8_t value)
+    {
+        rex_byte(RAX, destination);
+        emit(0xB0 + (destination & 7));
+        emit(value);
+    }
+
+    void add8_imm(const Register destination, const std::uint8_t value)
+    {
+        rex_byte(RAX, destination);
+        emit(0x80);
+        modrm(3, 0, destination);
+        emit(value);
+    }
+
+    void cmp8_imm(const Register destination, const std::uint8_t value)
+    {
+        rex_byte(RAX, destination);
+        emit(0x80);
+        modrm(3, 7, destination);
+        emit(value);
+    }
+
+    void shr8_one(const Register destination)
+    {
+        rex_byte(RAX, destination);
+        emit(0xD0);
+        modrm(3, 5, destination);
+    }
+
+    void shl8_one(const Register destination)
+    {
+        rex_byte(RAX, destination);
+        emit(0xD0);
+        modrm(3, 4, destination);
+    }
+
+    void setcc(const Condition condition, const Register destination)
+    {
+        rex_byte(RAX, destination);
+        emit(0x0F);
+        emit(0x90 | condition);
+        modrm(3, 0, destination);
+    }
+
+    void cmovcc32(const Condition condition, const Register destination, const Register source)
+    {
+        rex(false, destination, source);
+        emit(0x0F);
+        emit(0x40 | condition);
+        modrm(3, destination, source);
+    }
+
+    void mov32(const Register destination, const Register source)
+    {
+        rex(false, destination, source);
+        emit(0x8B);
+        modrm(3, destination, source);
+    }
+
+    void add32(const Register destination, const Register source)
+    {
+        rex(false, destination, source);
+        emit(0x03);
+        modrm(3, destination, source);
+    }
+
+    void mov32_imm(const Register destination, const std::uint32_t value)
+    {
+        rex(false, RAX, destination);
+        emit(0xB8 + (destination & 7));
+        emit32(value);
+    }
+
+    void cmp32_imm(const Register destination, const std::uint32_t value)
+    {
+        rex(false, RAX, destination);
+        emit(0x81);
+        modrm(3, 7, destination);
+        emit32(value);
+    }
+
+    // movzx r32, byte [rbp + offset]
+    void load8(const Register destination, const std::uint32_t offset)
+    {
+        rex(false, destination, RBP);
+        emit(0x0F);
+        emit(0xB6);
+        modrm(2, destination, RBP);
+        emit32(offset);
+    }
+
+    // movzx r32, word [rbp + offset]
+    void load16(const Register destination, const std::uint32_t offset)
+    {
+        rex(false, destination, RBP);
+        emit(0x0F);
+        emit(0xB7);
+        modrm(2, destination, RBP);
+        emit32(offset);
+    }
+
+    // mov byte [rbp + offset], r8
+    void store8(const std::uint32_t offset, const Register source)
+    {
+        rex_byte(source, RBP);
+        emit(0x88);
+        modrm(2, source, RBP);
+        emit32(offset);
+    }
+
+    // mov word [rbp + offset], r16
+    void store16(const std::uint32_t offset, const Register source)
+    {
+        emit(0x66);
+        rex(false, source, RBP);
+        emit(0x89);
+        modrm(2, source, RBP);
+        emit32(offset);
+    }
+
+    // mov word [rbp + offset], imm16
+    void store16_imm(const std::uint32_t offset, const std::uint16_t value)
+    {
+        emit(0x66);
+        emit(0xC7);
+        modrm(2, 0, RBP);
+        emit32(offset);
+        emit(value & 0xFF);
+        emit(value >> 8);
+    }
+
+    void mov64(const Register destination, const Register source)
+    {
+        rex(true, source, destination);
+        emit(0x89);
+        modrm(3, source, destination);
+    }
+
+    void push(const Register reg)
+    {
+        rex(false, RAX, reg);
+        emit(0x50 + (reg & 7));
+    }
+
+    void pop(const Register reg)
+    {
+        rex(false, RAX, reg);
+        emit(0x58 + (reg & 7));
+    }
+
+    void ret()
+    {
+        emit(0xC3);
+    }
+
+private:
+    void emit(const std::uint8_t value)
+    {
+        code.push_back(value);
+    }
+
+    void emit32(const std::uint32_t value)
+    {
+        for (std::uint32_t i{0}; i < 4; i++)
+        {
+            emit(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void modrm(const std::uint8_t mod, const std::uint8_t reg, const std::uint8_t rm)
+    {
+        emit(static_cast<std::uint8_t>(mod << 6 | (reg & 7) << 3 | (rm & 7)));
+    }
+
+    // REX prefix, only emitted when needed
+    void rex(const bool wide, const std::uint8_t reg, const std::uint8_t rm)
+    {
+        const std::uint8_t prefix{static_cast<std::uint8_t>(0x40 | wide << 3 | (reg >> 3) << 2 | (rm >> 3))};
+        if (prefix != 0x40)
+        {
+            emit(prefix);
+        }
+    }
+
+    // REX prefix for byte register operands, always emitted so SIL and DIL are reachable instead of DH and BH
+    void rex_byte(const std::uint8_t reg, const std::uint8_t rm)
+    {
+        emit(static_cast<std::uint8_t>(0x40 | (reg >> 3) << 2 | (rm >> 3)));
+    }
+};
+
+enum class OpcodeKind
+{
+    // Exits to C++
+    NotCompilable,
+    // Compiled inside the block
+    Body,
+    // Compiled, and ends the block by writing the program counter
+    Terminator,
+};
+
+OpcodeKind classify(const std::uint16_t opcode)
+{
+    switch (opcode >> 12)
+    {
+        case 0x1:
+        case 0x3:
+        case 0x4:
+            return OpcodeKind::Terminator;
+
+        case 0x5:
+        case 0x9:
+            return (opcode & 0xF) == 0x0 ? OpcodeKind::Terminator : OpcodeKind::NotCompilable;
+
+        case 0x6:
+        case 0x7:
+        case 0xA:
+            return OpcodeKind::Body;
+
+        case 0x8:
+            return ((opcode & 0xF) <= 0x7 || (opcode & 0xF) == 0xE) ? OpcodeKind::Body : OpcodeKind::NotCompilable;
+
+        case 0xF:
+            switch (opcode & 0xFF)
+            {
+                case 0x07:
+                case 0x15:
+                case 0x18:
+                case 0x1E:
+                    return OpcodeKind::Body;
+                default:
+                    return OpcodeKind::NotCompilable;
+            }
+
+        default:
+            return OpcodeKind::NotCompilable;
+    }
+}
+
+// Returns a mask of the V registers (bits 0 to 15) and I (bit 16) a compilable opcode accesses
+std::uint32_t registers_used(const Chip8 &chip8, const std::uint16_t opcode)
+{
+    const std::uint32_t x{1u << ((opcode >> 8) & 0xF)};
+    const std::uint32_t y{1u << ((opcode >> 4) & 0xF)};
+    const std::uint32_t flag{1u << 0xF};
+    const std::uint32_t index{1u << INDEX_REGISTER};
+
+    switch (opcode >> 12)
+    {
+        case 0x3:
+        case 0x4:
+        case 0x6:
+        case 0x7:
+            return x;
+
+        case 0x5:
+        case 0x9:
+            return x | y;
+
+        case 0x8:
+            switch (opcode & 0xF)
+            {
+                case 0x0:
+                    return x | y;
+                case 0x1:
+                case 0x2:
+                case 0x3:
+                    return x | y | (chip8.cosmac ? flag : 0);
+                default:
+                    return x | y | flag;
+            }
+
+        case 0xA:
+            return index;
+
+        case 0xF:
+            if ((opcode & 0xFF) == 0x1E)
+            {
+                return x | index | (chip8.amiga ? flag : 0);
+            }
+            return x;
+
+        default:
+            return 0;
+    }
+}
+
+std::uint32_t offset_of(const Chip8 &chip8, const void *field)
+{
+    return static_cast<std::uint32_t>(reinterpret_cast<const std::uint8_t *>(field) -
+                                      reinterpret_cast<const std::uint8_t *>(&chip8));
+}
+
+std::uint8_t *allocate_code_memory(const std::size_t size)
+{
+#if defined(_WIN32)
+    return static_cast<std::uint8_t *>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+    void *memory{mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+    return memory == MAP_FAILED ? nullptr : static_cast<std::uint8_t *>(memory);
+#endif
+}
+
+void release_code_memory(std::uint8_t *memory, const std::size_t size)
+{
+#if defined(_WIN32)
+    (void)size;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, size);
+#endif
+}
+
+// Code memory is never writable and executable at the same time
+bool set_code_memory_executable(std::uint8_t *memory, const std::size_t size, const bool executable)
+{
+#if defined(_WIN32)
+    DWORD old_protection{};
+    if (!VirtualProtect(memory, size, executable ? PAGE_EXECUTE_READ : PAGE_READWRITE, &old_protection))
+    {
+        return false;
+    }
+    if (executable)
+    {
+        FlushInstructionCache(GetCurrentProcess(), memory, size);
+    }
+    return true;
+#else
+    return mprotect(memory, size, executable ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+}  // namespace
+
+JitCache::JitCache() :
+    code_memory(allocate_code_memory(CODE_MEMORY_SIZE))
+{
+    if (code_memory && !set_code_memory_executable(code_memory, CODE_MEMORY_SIZE, true))
+    {
+        disable();
+    }
+}
+
+JitCache::~JitCache()
+{
+    if (code_memory)
+    {
+        release_code_memory(code_memory, CODE_MEMORY_SIZE);
+    }
+}
+
+template <typename Quirks>
+bool JitCache::run(Chip8 &chip8, const std::uint64_t count, const bool stop_at_frame_wait, std::uint64_t &executed)
+{
+    executed = 0;
+
+    while (executed < count)
+    {
+        if (stop_at_frame_wait && at_frame_wait(chip8))
+        {
+            return true;
+        }
+
+        if (chip8.pc < MEMORY_SIZE - 1)
+        {
+            const Block &block{blocks[chip8.pc]};
+            if (block.state == BlockState::NotCompiled)
+            {
+                compile(chip8, chip8.pc);
+            }
+
+            if (block.state == BlockState::Compiled && block.instruction_count <= count - executed)
+            {
+                block.code(&chip8);
+                executed += block.instruction_count;
+                continue;
+            }
+        }
+
+        if (!step<Quirks>(chip8))
+        {
+            return false;
+        }
+        executed++;
+    }
+
+    return true;
+}
+
+void JitCache::flush()
+{
+    flush_blocks();
+    self_modified.fill(false);
+}
+
+void JitCache::flush_blocks()
+{
+    blocks.fill(Block{});
+    code_map.fill(false);
+    code_used = 0;
+}
+
+void JitCache::disable()
+{
+    flush_blocks();
+    release_code_memory(code_memory, CODE_MEMORY_SIZE);
+    code_memory = nullptr;
+}
+
+void JitCache::compile(const Chip8 &chip8, const std::uint16_t address)
+{
+    Block &block{blocks[address]};
+    block.state = BlockState::Interpreted;
+
+    if (!code_memory)
+    {
+        return;
+    }
+
+    // First pass: find the block extent and the registers it needs, staying within the allocatable host registers
+    std::vector<std::uint16_t> opcodes;
+    std::uint32_t used_mask{0};
+    bool terminated{false};
+    std::uint32_t current{address};
+
+    while (opcodes.size() < MAX_BLOCK_INSTRUCTIONS && current + 1 < MEMORY_SIZE)
+    {
+        const std::uint16_t opcode{static_cast<std::uint16_t>(chip8.memory[current] << 8 | chip8.memory[current + 1])};
+        const OpcodeKind kind{classify(opcode)};
+        if (kind == OpcodeKind::NotCompilable || self_modified[current] || self_modified[current + 1])
+        {
+            break;
+        }
+
+        // FX07 always starts a block, so run() can stop in front of it. FX0A is never compiled
+        if (!opcodes.empty() && (opcode & 0xF0FF) == 0xF007)
+        {
+            break;
+        }
+
+        const std::uint32_t mask{used_mask | registers_used(chip8, opcode)};
+        std::uint32_t needed{0};
+        for (std::uint32_t i{0}; i <= INDEX_REGISTER; i++)
+        {
+            needed += (mask >> i) & 0x1;
+        }
+        if (needed > ALLOCATABLE.size())
+        {
+            break;
+        }
+
+        used_mask = mask;
+        opcodes.push_back(opcode);
+        current += 2;
+
+        if (kind == OpcodeKind::Terminator)
+        {
+            terminated = true;
+            break;
+        }
+    }
+
+    if (opcodes.empty())
+    {
+        return;
+    }
+
+    // Second pass: emit the code
+    const std::uint32_t registers_offset{offset_of(chip8, chip8.registers.data())};
+    const std::uint32_t index_offset{offset_of(chip8, &chip8.index_register)};
+    const std::uint32_t pc_offset{offset_of(chip8, &chip8.pc)};
+    const std::uint32_t delay_offset{offset_of(chip8, &chip8.delay_timer)};
+    const std::uint32_t sound_offset{offset_of(chip8, &chip8.sound_timer)};
+
+    std::array<Register, INDEX_REGISTER + 1> host{};
+    std::size_t allocated{0};
+    for (std::uint32_t i{0}; i <= INDEX_REGISTER; i++)
+    {
+        if ((used_mask >> i) & 0x1)
+        {
+            host[i] = ALLOCATABLE[allocated++];
+        }
+    }
+
+    Emitter emitter;
+
+    for (const Register reg : SAVED)
+    {
+        emitter.push(reg);
+    }
+#if defined(_WIN32)
+    emitter.mov64(RBP, RCX);
+#else
+    emitter.mov64(RBP, RDI);
+#endif
+
+    for (std::uint32_t i{0}; i < INDEX_REGISTER; i++)
+    {
+        if ((used_mask >> i) & 0x1)
+        {
+            emitter.load8(host[i], registers_offset + i);
+        }
+    }
+    if ((used_mask >> INDEX_REGISTER) & 0x1)
+    {
+        emitter.load16(host[INDEX_REGISTER], index_offset);
+    }
+
+    const std::size_t body_count{terminated ? opcodes.size() - 1 : opcodes.size()};
+    for (std::size_t i{0}; i < body_count; i++)
+    {
+        const std::uint16_t opcode{opcodes[i]};
+        const Register x{host[(opcode >> 8) & 0xF]};
+        const Register y{host[(opcode >> 4) & 0xF]};
+        const Register flag{host[0xF]};
+        const Register index{host[INDEX_REGISTER]};
+        const std::uint8_t nn{static_cast<std::uint8_t>(opcode & 0xFF)};
+
+        switch (opcode >> 12)
+        {
+            case 0x6:
+                emitter.mov8_imm(x, nn);
+                break;
+
+            case 0x7:
+                emitter.add8_imm(x, nn);
+                break;
+
+            case 0x8:
+                switch (opcode & 0xF)
+                {
+                    case 0x0:
+                        emitter.byte_operation(MOV, x, y);
+                        break;
+
+                    case 0x1:
+                    case 0x2:
+                    case 0x3:
+                    {
+                        const ByteOperation operations[]{OR, AND, XOR};
+                        emitter.byte_operation(operations[(opcode & 0xF) - 1], x, y);
+                        if (chip8.cosmac)
+                        {
+                            emitter.mov8_imm(flag, 0x0);
+                        }
+                        break;
+                    }
+
+                    case 0x4:
+                        emitter.byte_operation(ADD, x, y);
+                        emitter.setcc(BELOW, RAX);
+                        emitter.byte_operation(MOV, flag, RAX);
+                        break;
+
+                    case 0x5:
+                        emitter.byte_operation(SUB, x, y);
+                        emitter.setcc(NOT_BELOW, RAX);
+                        emitter.byte_operation(MOV, flag, RAX);
+                        break;
+
+                    case 0x6:
+                        if (chip8.cosmac)
+                        {
+                            emitter.byte_operation(MOV, x, y);
+                        }
+                        emitter.shr8_one(x);
+                        emitter.setcc(BELOW, RAX);
+                        emitter.byte_operation(MOV, flag, RAX);
+                        break;
+
+                    case 0x7:
+                        emitter.byte_operation(MOV, RAX, y);
+                        emitter.byte_operation(SUB, RAX, x);
+                        emitter.setcc(NOT_BELOW, RCX);
+                        emitter.byte_operation(MOV, x, RAX);
+                        emitter.byte_operation(MOV, flag, RCX);
+                        break;
+
+                    case 0xE:
+                        if (chip8.cosmac)
+                        {
+                            emitter.byte_operation(MOV, x, y);
+                        }
+                        emitter.shl8_one(x);
+                        emitter.setcc(BELOW, RAX);
+                        emitter.byte_operation(MOV, flag, RAX);
+                        break;
+                }
+                break;
+
+            case 0xA:
+                emitter.mov32_imm(index, opcode & 0x0FFF);
+                break;
+
+            case 0xF:
+                switch (opcode & 0xFF)
+                {
+                    case 0x07:
+                        emitter.load8(x, delay_offset);
+                        break;
+
+                    case 0x15:
+                        emitter.store8(delay_offset, x);
+                        break;
+
+                    case 0x18:
+                        emitter.store8(sound_offset, x);
+                        break;
+
+                    case 0x1E:
+                        // I = min(I + VX, 0xFFF), setting VF on overflow with the amiga quirk
+                        emitter.mov32(RAX, index);
+                        emitter.add32(RAX, x);
+                        emitter.mov32_imm(RCX, 0x0FFF);
+                        emitter.cmp32_imm(RAX, 0x0FFF);
+                        emitter.cmovcc32(ABOVE, RAX, RCX);
+                        if (chip8.amiga)
+                        {
+                            emitter.mov32_imm(RCX, 0x1);
+                            emitter.cmovcc32(ABOVE, flag, RCX);
+                        }
+                        emitter.mov32(index, RAX);
+                        break;
+                }
+                break;
+        }
+    }
+
+    // Write the program counter, the comparison flags of a skip survive the register moves
+    const std::uint16_t next{static_cast<std::uint16_t>(current)};
+    if (!terminated)
+    {
+        emitter.store16_imm(pc_offset, next);
+    }
+    else
+    {
+        const std::uint16_t opcode{opcodes.back()};
+        const Register x{host[(opcode >> 8) & 0xF]};
+        const Register y{host[(opcode >> 4) & 0xF]};
+
+        if ((opcode >> 12) == 0x1)
+        {
+            emitter.store16_imm(pc_offset, opcode & 0x0FFF);
+        }
+        else
+        {
+            Condition skip_condition{EQUAL};
+            switch (opcode >> 12)
+            {
+                case 0x3:
+                    emitter.cmp8_imm(x, opcode & 0xFF);
+                    skip_condition = EQUAL;
+                    break;
+                case 0x4:
+                    emitter.cmp8_imm(x, opcode & 0xFF);
+                    skip_condition = NOT_EQUAL;
+                    break;
+                case 0x5:
+                    emitter.byte_operation(CMP, x, y);
+                    skip_condition = EQUAL;
+                    break;
+                case 0x9:
+                    emitter.byte_operation(CMP, x, y);
+                    skip_condition = NOT_EQUAL;
+                    break;
+            }
+            emitter.mov32_imm(RAX, next);
+            emitter.mov32_imm(RCX, next + 2);
+            emitter.cmovcc32(skip_condition, RAX, RCX);
+            emitter.store16(pc_offset, RAX);
+        }
+    }
+
+    for (std::uint32_t i{0}; i < INDEX_REGISTER; i++)
+    {
+        if ((used_mask >> i) & 0x1)
+        {
+            emitter.store8(registers_offset + i, host[i]);
+        }
+    }
+    if ((used_mask >> INDEX_REGISTER) & 0x1)
+    {
+        emitter.store16(index_offset, host[INDEX_REGISTER]);
+    }
+
+    for (auto reg{SAVED.rbegin()}; reg != SAVED.rend(); ++reg)
+    {
+        emitter.pop(*reg);
+    }
+    emitter.ret();
+
+    // Start over once the arena is full
+    if (code_used + emitter.code.size() > CODE_MEMORY_SIZE)
+    {
+        flush_blocks();
+    }
+
+    // Only the pages being written lose their execute permission
+    const std::size_t first_page{code_used / CODE_PAGE_SIZE * CODE_PAGE_SIZE};
+    const std::size_t pages_size{(code_used + emitter.code.size() + CODE_PAGE_SIZE - 1) / CODE_PAGE_SIZE *
+                                     CODE_PAGE_SIZE -
+                                 first_page};
+
+    if (!set_code_memory_executable(code_memory + first_page, pages_size, false))
+    {
+        disable();
+        return;
+    }
+    std::memcpy(code_memory + code_used, emitter.code.data(), emitter.code.size());
+    if (!set_code_memory_executable(code_memory + first_page, pages_size, true))
+    {
+        disable();
+        return;
+    }
+
+    // Converting an object pointer to a function pointer is only conditionally supported, copy the address instead
+    const std::uint8_t *entry{code_memory + code_used};
+    std::memcpy(&block.code, &entry, sizeof(block.code));
+    block.instruction_count = static_cast<std::uint32_t>(opcodes.size());
+    block.state = BlockState::Compiled;
+    code_used += emitter.code.size();
+
+    std::fill(code_map.begin() + address, code_map.begin() + current, true);
+}
+
+template <typename Quirks>
+bool JitCache::step(Chip8 &chip8)
+{
+    if (chip8.pc >= MEMORY_SIZE - 1)
+    {
+        return ::step<Quirks>(chip8);
+    }
+
+    const DecodedInstruction instruction{
+        DecodeCache::decode<Quirks>(chip8.memory[chip8.pc] << 8 | chip8.memory[chip8.pc + 1])};
+    chip8.pc += 2;
+
+    if (instruction.write_length == 0)
+    {
+        return instruction.handler(chip8, instruction);
+    }
+
+    const std::uint32_t address{chip8.index_register};
+    const bool success{instruction.handler(chip8, instruction)};
+
+    // On machines with wrap_memory, a write running past the end of memory continues at address 0
+    const std::uint32_t end{address + instruction.write_length};
+    const std::array<std::pair<std::uint32_t, std::uint32_t>, 2> ranges{
+        {{address, std::min(end, MEMORY_SIZE)}, {0, end > MEMORY_SIZE ? end - MEMORY_SIZE : 0}}};
+    for (const auto &[first, last] : ranges)
+    {
+        if (first < last &&
+            std::any_of(code_map.begin() + first, code_map.begin() + last, [](const bool code) { return code; }))
+        {
+            std::fill(self_modified.begin() + first, self_modified.begin() + last, true);
+            flush_blocks();
+        }
+    }
+
+    return success;
+}
+
+#define INSTANTIATE_JIT_CACHE(Quirks)                                                                                  \
+    template bool JitCache::run<Quirks>(Chip8 &, std::uint64_t, bool, std::uint64_t &);
+
+CHIP8_FOR_EACH_QUIRK_PROFILE(INSTANTIATE_JIT_CACHE)
@@ -0,0 +1,91 @@
+#ifndef JIT_X64_HPP
+#define JIT_X64_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "chip8.hpp"
+
+// Dynamic recompiler emitting x86-64 machine code for hot CHIP-8 blocks. A block covers a straight-line run of
+// register, index and timer instructions, optionally ending with a jump or skip. The V registers and I it touches
+// live in host registers for the whole block. Every other instruction (DXYN, key and memory instructions, calls...)
+// exits to C++ and runs through the decoder one at a time
+class JitCache
+{
+public:
+    JitCache();
+    ~JitCache();
+
+    JitCache(const JitCache &) = delete;
+    JitCache &operator=(const JitCache &) = delete;
+
+    // Whether executable memory could be allocated. If not, the caller has to use another engine
+    bool available() const
+    {
+        return code_memory != nullptr;
+    }
+
+    // Executes exactly count instructions, or fewer if a fault stops execution, in which case false is returned. With
+    // stop_at_frame_wait, also stops early in front of an instruction for which at_frame_wait() holds. The number of
+    // instructions executed is stored in executed. Quirks is the profile matching the machine's flags, used by the
+    // instructions that run through the decoder
+    template <typename Quirks>
+    bool run(Chip8 &chip8, std::uint64_t count, bool stop_at_frame_wait, std::uint64_t &executed);
+
+    // Drops every compiled block, needed whenever memory is rewritten from outside the interpreter, or the quirk
+    // configuration changes, since quirks are baked into the generated code
+    void flush();
+
+    // Host page size assumed when changing the protection of part of the arena
+    static const std::size_t CODE_PAGE_SIZE{4096};
+
+    // Longest block compiled, in instructions
+    static const std::uint32_t MAX_BLOCK_INSTRUCTIONS{64};
+
+    // Size of the executable memory arena. Once full, every block is dropped and compilation starts over
+    static const std::size_t CODE_MEMORY_SIZE{1 << 20};
+
+private:
+    using BlockFunction = void (*)(Chip8 *chip8);
+
+    enum class BlockState : std::uint8_t
+    {
+        NotCompiled,
+        Compiled,
+        // The instruction at this address can't be compiled and always runs through the decoder
+        Interpreted,
+    };
+
+    struct Block
+    {
+        BlockFunction code{nullptr};
+        std::uint32_t instruction_count{};
+        BlockState state{BlockState::NotCompiled};
+    };
+
+    std::array<Block, 4096> blocks{};
+    // Marks the memory bytes covered by a compiled block
+    std::array<bool, 4096> code_map{};
+    // Marks the memory bytes the ROM wrote while they were compiled. Instructions overlapping them are always
+    // interpreted, so a self-modifying loop doesn't recompile on every iteration
+    std::array<bool, 4096> self_modified{};
+
+    std::uint8_t *code_memory{nullptr};
+    std::size_t code_used{0};
+
+    // Compiles the block starting at address, or marks it as interpreted
+    void compile(const Chip8 &chip8, std::uint16_t address);
+
+    // Executes a single instruction through the decoder, flushing the blocks if it writes onto compiled code
+    template <typename Quirks>
+    bool step(Chip8 &chip8);
+
+    // Drops every compiled block, keeping the self-modified bytes
+    void flush_blocks();
+
+    // Releases the executable memory after a protection change failed, every instruction is interpreted from then on
+    void disable();
+};
+
+#endif  // JIT_X64_HPP
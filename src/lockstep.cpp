@@ -0,0 +1,609 @@
+#include "lockstep.hpp"
+
+#include "emulator_utils.hpp"
+#include "instructions.hpp"
+
+namespace
+{
+// Lane loops are written without branches, selecting the new value through the lane mask, so they vectorize
+template <std::size_t LANES>
+void blend(std::array<std::uint8_t, LANES> &target,
+           const std::array<std::uint8_t, LANES> &values,
+           const std::array<std::uint8_t, LANES> &mask)
+{
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        target[lane] = static_cast<std::uint8_t>((values[lane] & mask[lane]) | (target[lane] & ~mask[lane]));
+    }
+}
+
+template <std::size_t LANES>
+void blend(std::array<std::uint8_t, LANES> &target,
+           const std::uint8_t value,
+           const std::array<std::uint8_t, LANES> &mask)
+{
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        target[lane] = static_cast<std::uint8_t>((value & mask[lane]) | (target[lane] & ~mask[lane]));
+    }
+}
+
+// Skips the next instruction on the lanes of the mask where condition is 0xFF
+template <std::size_t LANES>
+void skip_if(std::array<std::uint16_t, LANES> &pc,
+             const std::array<std::uint8_t, LANES> &condition,
+             const std::array<std::uint8_t, LANES> &mask)
+{
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        pc[lane] = static_cast<std::uint16_t>(pc[lane] + (condition[lane] & mask[lane] & 0x2));
+    }
+}
+}  // namespace
+
+template <std::size_t LANES>
+LockstepInterpreter<LANES>::LockstepInterpreter() : machines(LANES)
+{
+}
+
+template <std::size_t LANES>
+void LockstepInterpreter<LANES>::load(const std::size_t lane, const Chip8 &chip8)
+{
+    machines[lane] = chip8;
+    read_fields(lane);
+
+    running[lane] = 0xFF;
+    quirks[lane] = static_cast<std::uint8_t>((chip8.cosmac ? 0x1 : 0x0) | (chip8.amiga ? 0x2 : 0x0));
+    instruction_count[lane] = 0;
+}
+
+template <std::size_t LANES>
+void LockstepInterpreter<LANES>::store(const std::size_t lane, Chip8 &chip8) const
+{
+    chip8 = machines[lane];
+    write_fields(lane, chip8);
+}
+
+template <std::size_t LANES>
+void LockstepInterpreter<LANES>::write_fields(const std::size_t lane, Chip8 &chip8) const
+{
+    for (std::size_t x{0}; x < registers.size(); x++)
+    {
+        chip8.registers[x] = registers[x][lane];
+    }
+    chip8.pc = pc[lane];
+    chip8.index_register = index_register[lane];
+    chip8.delay_timer = delay_timer[lane];
+    chip8.sound_timer = sound_timer[lane];
+}
+
+template <std::size_t LANES>
+void LockstepInterpreter<LANES>::read_fields(const std::size_t lane)
+{
+    const Chip8 &chip8{machines[lane]};
+
+    for (std::size_t x{0}; x < registers.size(); x++)
+    {
+        registers[x][lane] = chip8.registers[x];
+    }
+    pc[lane] = chip8.pc;
+    index_register[lane] = chip8.index_register;
+    delay_timer[lane] = chip8.delay_timer;
+    sound_timer[lane] = chip8.sound_timer;
+}
+
+template <std::size_t LANES>
+void LockstepInterpreter<LANES>::run(const std::uint64_t count)
+{
+    // Once every lane has stopped there is nothing left to fetch
+    std::uint8_t any_running{0};
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        any_running |= running[lane];
+    }
+    if (any_running == 0)
+    {
+        return;
+    }
+
+    for (std::uint64_t i{0}; i < count; i++)
+    {
+        if (!step())
+        {
+            run_lanes(count - i);
+            return;
+        }
+    }
+}
+
+template <std::size_t LANES>
+void LockstepInterpreter<LANES>::run_lanes(const std::uint64_t count)
+{
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        if (running[lane] == 0)
+        {
+            continue;
+        }
+
+        write_fields(lane, machines[lane]);
+        for (std::uint64_t i{0}; i < count; i++)
+        {
+            if (!::step(machines[lane]))
+            {
+                running[lane] = 0;
+                break;
+            }
+            instruction_count[lane]++;
+        }
+        read_fields(lane);
+    }
+}
+
+template <std::size_t LANES>
+void LockstepInterpreter<LANES>::tick_timers()
+{
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        delay_timer[lane] = static_cast<std::uint8_t>(delay_timer[lane] - ((delay_timer[lane] != 0) & running[lane]));
+        sound_timer[lane] = static_cast<std::uint8_t>(sound_timer[lane] - ((sound_timer[lane] != 0) & running[lane]));
+    }
+}
+
+template <std::size_t LANES>
+bool LockstepInterpreter<LANES>::step()
+{
+    // Stopped lanes fetch too, masking the address keeps them in bounds and their opcode is never used
+    LaneWords opcodes{};
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        const std::uint8_t *memory{machines[lane].memory.data()};
+        const std::uint16_t address{static_cast<std::uint16_t>(pc[lane] & 0x0FFF)};
+        opcodes[lane] = static_cast<std::uint16_t>(memory[address] << 8 | memory[(address + 1) & 0x0FFF]);
+    }
+
+    // An opcode starting at the last byte would run past the end of memory, those lanes go through step() to fail
+    // exactly like the scalar interpreter
+    LaneBytes out_of_range{};
+    std::uint8_t any_out_of_range{0};
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        out_of_range[lane] = static_cast<std::uint8_t>(running[lane] & -static_cast<std::uint8_t>(pc[lane] >= 4095));
+        any_out_of_range |= out_of_range[lane];
+    }
+
+    LaneBytes pending{};
+    std::size_t grouped_lanes{0};
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        pending[lane] = static_cast<std::uint8_t>(running[lane] & ~out_of_range[lane]);
+        grouped_lanes += pending[lane] & 0x1;
+    }
+
+    // The first pending lane leads a group of every lane sharing its opcode and quirks. When every lane runs the same
+    // code that group covers them all, otherwise the lanes left over are bucketed into more groups in a single pass
+    std::array<std::uint16_t, MAX_GROUPS> group_opcodes{};
+    std::array<std::uint8_t, MAX_GROUPS> group_quirks{};
+    std::array<LaneBytes, MAX_GROUPS> group_masks{};
+    std::size_t group_count{0};
+    std::uint8_t left_over{0};
+
+    std::size_t leader{0};
+    while (leader < LANES && pending[leader] == 0)
+    {
+        leader++;
+    }
+    if (leader < LANES)
+    {
+        group_opcodes[0] = opcodes[leader];
+        group_quirks[0] = quirks[leader];
+        group_count = 1;
+        for (std::size_t lane{0}; lane < LANES; lane++)
+        {
+            const std::uint8_t member{
+                static_cast<std::uint8_t>((opcodes[lane] == group_opcodes[0]) & (quirks[lane] == group_quirks[0]))};
+            group_masks[0][lane] = static_cast<std::uint8_t>(pending[lane] & -member);
+            left_over |= static_cast<std::uint8_t>(pending[lane] & ~group_masks[0][lane]);
+        }
+    }
+
+    for (std::size_t lane{leader + 1}; left_over != 0 && lane < LANES; lane++)
+    {
+        if (pending[lane] == 0 || group_masks[0][lane] != 0)
+        {
+            continue;
+        }
+
+        std::size_t group{1};
+        while (group < group_count && (group_opcodes[group] != opcodes[lane] || group_quirks[group] != quirks[lane]))
+        {
+            group++;
+        }
+
+        if (group == group_count)
+        {
+            if (group_count == MAX_GROUPS)
+            {
+                return false;
+            }
+
+            group_opcodes[group] = opcodes[lane];
+            group_quirks[group] = quirks[lane];
+            group_count++;
+        }
+        group_masks[group][lane] = 0xFF;
+    }
+
+    // Nothing has executed yet, so the lanes can still be handed to run_lanes()
+    if (grouped_lanes < group_count * MIN_GROUP_LANES)
+    {
+        return false;
+    }
+
+    if (any_out_of_range != 0)
+    {
+        for (std::size_t lane{0}; lane < LANES; lane++)
+        {
+            if (out_of_range[lane] != 0)
+            {
+                execute_lane(lane, true, 0);
+            }
+        }
+    }
+
+    for (std::size_t group{0}; group < group_count; group++)
+    {
+        execute_group(group_opcodes[group], group_quirks[group], group_masks[group]);
+    }
+
+    return true;
+}
+
+template <std::size_t LANES>
+void LockstepInterpreter<LANES>::execute_group(const std::uint16_t opcode,
+                                               const std::uint8_t group_quirks,
+                                               const LaneBytes mask)
+{
+    const std::uint8_t x{static_cast<std::uint8_t>((opcode & 0x0F00) >> 8)};
+    const std::uint8_t y{static_cast<std::uint8_t>((opcode & 0x00F0) >> 4)};
+    const std::uint8_t n{static_cast<std::uint8_t>(opcode & 0x000F)};
+    const std::uint8_t nn{static_cast<std::uint8_t>(opcode & 0x00FF)};
+    const std::uint16_t nnn{static_cast<std::uint16_t>(opcode & 0x0FFF)};
+    const bool cosmac{(group_quirks & 0x1) != 0};
+    const bool amiga{(group_quirks & 0x2) != 0};
+
+    // Every lane of the group fetched the opcode
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        pc[lane] = static_cast<std::uint16_t>(pc[lane] + (mask[lane] & 0x2));
+    }
+
+    LaneBytes &v_x{registers[x]};
+    LaneBytes &v_f{registers[0xF]};
+    // Operands are read before anything is written, as X or Y may be F
+    const LaneBytes old_x{registers[x]};
+    const LaneBytes old_y{registers[y]};
+    LaneBytes result{};
+    LaneBytes flag{};
+
+    bool handled{true};
+    switch (opcode >> 12)
+    {
+        // Per lane, but only the fields the instruction uses are copied in and out of the lane's Chip8
+        case 0x0:
+            if (opcode == 0x00E0)
+            {
+                execute_lanes(mask, [](Chip8 &chip8, std::size_t) { op_00E0(chip8); });
+                return;
+            }
+            if (opcode == 0x00EE)
+            {
+                execute_lanes(mask,
+                              [this](Chip8 &chip8, const std::size_t lane)
+                              {
+                                  chip8.pc = pc[lane];
+                                  op_00EE(chip8);
+                                  pc[lane] = chip8.pc;
+                              });
+                return;
+            }
+            handled = false;
+            break;
+
+        case 0x2:
+            execute_lanes(mask,
+                          [this, opcode](Chip8 &chip8, const std::size_t lane)
+                          {
+                              chip8.pc = pc[lane];
+                              op_2NNN(chip8, opcode);
+                              pc[lane] = chip8.pc;
+                          });
+            return;
+
+        case 0xD:
+        {
+            // Lanes of a group share their quirks, so the whole group runs the same specialization
+            const QuirkProfile profile{cosmac ? (amiga ? QuirkProfile::CosmacAmiga : QuirkProfile::Cosmac)
+                                              : (amiga ? QuirkProfile::Amiga : QuirkProfile::Modern)};
+            with_quirk_profile(
+                profile,
+                [this, mask, opcode, x, y](auto quirks)
+                {
+                    execute_lanes(mask,
+                                  [this, opcode, x, y](Chip8 &chip8, const std::size_t lane)
+                                  {
+                                      chip8.registers[x] = registers[x][lane];
+                                      chip8.registers[y] = registers[y][lane];
+                                      chip8.index_register = index_register[lane];
+                                      // Only read if the sprite faults, to record its address
+                                      chip8.pc = pc[lane];
+                                      op_DXYN<decltype(quirks)>(chip8, opcode, x, y);
+                                      // A faulting sprite leaves VF untouched, and the lane's copy of it may be stale
+                                      if (chip8.fault.kind == FaultKind::None)
+                                      {
+                                          registers[0xF][lane] = chip8.registers[0xF];
+                                      }
+                                  });
+                });
+            return;
+        }
+
+        case 0x1:
+            for (std::size_t lane{0}; lane < LANES; lane++)
+            {
+                pc[lane] = static_cast<std::uint16_t>(mask[lane] != 0 ? nnn : pc[lane]);
+            }
+            break;
+
+        case 0x3:
+        case 0x4:
+        {
+            // 4XNN skips when the values differ
+            const std::uint8_t invert{static_cast<std::uint8_t>((opcode >> 12) == 0x3 ? 0x00 : 0xFF)};
+            for (std::size_t lane{0}; lane < LANES; lane++)
+            {
+                result[lane] = static_cast<std::uint8_t>((old_x[lane] == nn ? 0xFF : 0x00) ^ invert);
+            }
+            skip_if(pc, result, mask);
+            break;
+        }
+
+        case 0x5:
+        case 0x9:
+        {
+            if (n != 0x0)
+            {
+                handled = false;
+                break;
+            }
+
+            // 9XY0 skips when the values differ
+            const std::uint8_t invert{static_cast<std::uint8_t>((opcode >> 12) == 0x5 ? 0x00 : 0xFF)};
+            for (std::size_t lane{0}; lane < LANES; lane++)
+            {
+                result[lane] = static_cast<std::uint8_t>((old_x[lane] == old_y[lane] ? 0xFF : 0x00) ^ invert);
+            }
+            skip_if(pc, result, mask);
+            break;
+        }
+
+        case 0x6:
+            blend(v_x, nn, mask);
+            break;
+
+        case 0x7:
+            for (std::size_t lane{0}; lane < LANES; lane++)
+            {
+                v_x[lane] = static_cast<std::uint8_t>(v_x[lane] + (nn & mask[lane]));
+            }
+            break;
+
+        case 0x8:
+            switch (n)
+            {
+                case 0x0:
+                    blend(v_x, old_y, mask);
+                    break;
+
+                case 0x1:
+                case 0x2:
+                case 0x3:
+                    for (std::size_t lane{0}; lane < LANES; lane++)
+                    {
+                        result[lane] = static_cast<std::uint8_t>(old_x[lane] | old_y[lane]);
+                    }
+                    if (n == 0x2)
+                    {
+                        for (std::size_t lane{0}; lane < LANES; lane++)
+                        {
+                            result[lane] = static_cast<std::uint8_t>(old_x[lane] & old_y[lane]);
+                        }
+                    }
+                    else if (n == 0x3)
+                    {
+                        for (std::size_t lane{0}; lane < LANES; lane++)
+                        {
+                            result[lane] = static_cast<std::uint8_t>(old_x[lane] ^ old_y[lane]);
+                        }
+                    }
+                    blend(v_x, result, mask);
+                    if (cosmac)
+                    {
+                        blend(v_f, 0x0, mask);
+                    }
+                    break;
+
+                case 0x4:
+                    for (std::size_t lane{0}; lane < LANES; lane++)
+                    {
+                        const std::uint16_t sum{static_cast<std::uint16_t>(old_x[lane] + old_y[lane])};
+                        result[lane] = static_cast<std::uint8_t>(sum);
+                        flag[lane] = static_cast<std::uint8_t>(sum >> 8);
+                    }
+                    blend(v_x, result, mask);
+                    blend(v_f, flag, mask);
+                    break;
+
+                case 0x5:
+                case 0x7:
+                {
+                    const LaneBytes &minuend{n == 0x5 ? old_x : old_y};
+                    const LaneBytes &subtrahend{n == 0x5 ? old_y : old_x};
+                    for (std::size_t lane{0}; lane < LANES; lane++)
+                    {
+                        result[lane] = static_cast<std::uint8_t>(minuend[lane] - subtrahend[lane]);
+                        flag[lane] = static_cast<std::uint8_t>(minuend[lane] >= subtrahend[lane] ? 0x1 : 0x0);
+                    }
+                    blend(v_x, result, mask);
+                    blend(v_f, flag, mask);
+                    break;
+                }
+
+                case 0x6:
+                case 0xE:
+                {
+                    const LaneBytes &source{cosmac ? old_y : old_x};
+                    for (std::size_t lane{0}; lane < LANES; lane++)
+                    {
+                        result[lane] = static_cast<std::uint8_t>(source[lane] >> 1);
+                        flag[lane] = static_cast<std::uint8_t>(source[lane] & 0x1);
+                    }
+                    if (n == 0xE)
+                    {
+                        for (std::size_t lane{0}; lane < LANES; lane++)
+                        {
+                            result[lane] = static_cast<std::uint8_t>(source[lane] << 1);
+                            flag[lane] = static_cast<std::uint8_t>(source[lane] >> 7);
+                        }
+                    }
+                    blend(v_x, result, mask);
+                    blend(v_f, flag, mask);
+                    break;
+                }
+
+                default:
+                    handled = false;
+                    break;
+            }
+            break;
+
+        case 0xA:
+            for (std::size_t lane{0}; lane < LANES; lane++)
+            {
+                index_register[lane] = static_cast<std::uint16_t>(mask[lane] != 0 ? nnn : index_register[lane]);
+            }
+            break;
+
+        case 0xF:
+            switch (nn)
+            {
+                case 0x07:
+                    blend(v_x, delay_timer, mask);
+                    break;
+
+                case 0x15:
+                    blend(delay_timer, old_x, mask);
+                    break;
+
+                case 0x18:
+                    blend(sound_timer, old_x, mask);
+                    break;
+
+                case 0x29:
+                    for (std::size_t lane{0}; lane < LANES; lane++)
+                    {
+                        const std::uint16_t address{
+                            static_cast<std::uint16_t>(FONT_ADDRESS + (old_x[lane] & 0x0F) * 0x5)};
+                        index_register[lane] =
+                            static_cast<std::uint16_t>(mask[lane] != 0 ? address : index_register[lane]);
+                    }
+                    break;
+
+                case 0x1E:
+                    for (std::size_t lane{0}; lane < LANES; lane++)
+                    {
+                        const std::uint16_t sum{static_cast<std::uint16_t>(index_register[lane] + old_x[lane])};
+                        const bool overflow{sum > 0x0FFF};
+                        const std::uint16_t address{static_cast<std::uint16_t>(overflow ? 0x0FFF : sum)};
+                        index_register[lane] =
+                            static_cast<std::uint16_t>(mask[lane] != 0 ? address : index_register[lane]);
+                        // VF is only set on overflow, and left alone otherwise
+                        flag[lane] = static_cast<std::uint8_t>(overflow && amiga ? mask[lane] : 0x00);
+                    }
+                    blend(v_f, 0x1, flag);
+                    break;
+
+                default:
+                    handled = false;
+                    break;
+            }
+            break;
+
+        default:
+            handled = false;
+            break;
+    }
+
+    if (handled)
+    {
+        for (std::size_t lane{0}; lane < LANES; lane++)
+        {
+            instruction_count[lane] += mask[lane] & 0x1;
+        }
+        return;
+    }
+
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        if (mask[lane] != 0)
+        {
+            execute_lane(lane, false, opcode);
+        }
+    }
+}
+
+template <std::size_t LANES>
+template <typename Operation>
+void LockstepInterpreter<LANES>::execute_lanes(const LaneBytes &mask, const Operation &operation)
+{
+    for (std::size_t lane{0}; lane < LANES; lane++)
+    {
+        if (mask[lane] == 0)
+        {
+            continue;
+        }
+
+        operation(machines[lane], lane);
+        if (machines[lane].fault.kind == FaultKind::None)
+        {
+            instruction_count[lane]++;
+        }
+        else
+        {
+            running[lane] = 0;
+        }
+    }
+}
+
+template <std::size_t LANES>
+void LockstepInterpreter<LANES>::execute_lane(const std::size_t lane, const bool fetch, const std::uint16_t opcode)
+{
+    write_fields(lane, machines[lane]);
+
+    const bool success{fetch ? ::step(machines[lane]) : execute(machines[lane], opcode)};
+
+    read_fields(lane);
+
+    if (success)
+    {
+        instruction_count[lane]++;
+    }
+    else
+    {
+        running[lane] = 0;
+    }
+}
+
+template class LockstepInterpreter<8>;
+template class LockstepInterpreter<16>;
+template class LockstepInterpreter<32>;
@@ -0,0 +1,96 @@
+#ifndef LOCKSTEP_HPP
+#define LOCKSTEP_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chip8.hpp"
+
+// Runs LANES machines side by side, one instruction per lane per step. The registers, program counters, index
+// registers and timers are stored as structure of arrays, so lanes sharing an opcode execute it together with
+// branchless lane loops the compiler turns into vector instructions. Lanes whose opcodes diverge run as separate
+// masked groups, and once the groups average fewer than MIN_GROUP_LANES lanes the rest of run() steps each lane on
+// its own.
+// Instructions without a lane-wide form (drawing, memory, stack, keys...) run through execute() on the lane's own
+// Chip8, which also holds the memory, display and stack of every lane
+template <std::size_t LANES>
+class LockstepInterpreter
+{
+public:
+    static_assert(LANES == 8 || LANES == 16 || LANES == 32, "Lockstep interpreters run 8, 16 or 32 lanes");
+
+    LockstepInterpreter();
+
+    // Copies a machine into a lane, which starts running from its program counter
+    void load(std::size_t lane, const Chip8 &chip8);
+    // Copies the current state of a lane out
+    void store(std::size_t lane, Chip8 &chip8) const;
+
+    // Executes count instructions on every running lane. A lane stops at the first fault, which is kept in its Chip8
+    // along with the state execute() left it in
+    void run(std::uint64_t count);
+
+    // Decrements the delay and sound timers of every running lane, meant to be called at 60Hz
+    void tick_timers();
+
+    // Whether the lane stopped, or was never loaded
+    bool stopped(std::size_t lane) const
+    {
+        return running[lane] == 0;
+    }
+
+    // Number of instructions the lane executed since it was loaded
+    std::uint64_t executed(std::size_t lane) const
+    {
+        return instruction_count[lane];
+    }
+
+private:
+    using LaneBytes = std::array<std::uint8_t, LANES>;
+    using LaneWords = std::array<std::uint16_t, LANES>;
+
+    // Groups averaging fewer lanes than this run slower than stepping each lane on its own
+    static constexpr std::size_t MIN_GROUP_LANES{4};
+    static constexpr std::size_t MAX_GROUPS{LANES / MIN_GROUP_LANES};
+
+    // registers[x][lane] is register VX of the lane
+    std::array<LaneBytes, 16> registers{};
+    LaneWords pc{};
+    LaneWords index_register{};
+    LaneBytes delay_timer{};
+    LaneBytes sound_timer{};
+
+    // 0xFF for running lanes, 0x00 for stopped ones
+    LaneBytes running{};
+    // Lanes only share a group with lanes using the same quirks, bit 0 is cosmac and bit 1 amiga
+    LaneBytes quirks{};
+    std::array<std::uint64_t, LANES> instruction_count{};
+
+    // Everything else of every lane. The fields above are only copied in and out around execute()
+    std::vector<Chip8> machines;
+
+    // Executes one instruction on every running lane. Returns false without executing anything if the groups would
+    // average fewer than MIN_GROUP_LANES lanes
+    bool step();
+    // Executes count instructions on every running lane, one lane at a time through step()
+    void run_lanes(std::uint64_t count);
+    // Executes opcode on the lanes selected by mask, 0xFF or 0x00 per lane
+    void execute_group(std::uint16_t opcode, std::uint8_t group_quirks, LaneBytes mask);
+    // Calls operation(chip8, lane) for every lane of the mask, stopping the lanes where it raises a fault
+    template <typename Operation>
+    void execute_lanes(const LaneBytes &mask, const Operation &operation);
+    // Executes the lane's instruction through step() or execute(), stopping the lane if it fails
+    void execute_lane(std::size_t lane, bool fetch, std::uint16_t opcode);
+
+    // Copies the lane's structure of arrays fields into a Chip8, and back from the lane's own Chip8
+    void write_fields(std::size_t lane, Chip8 &chip8) const;
+    void read_fields(std::size_t lane);
+};
+
+extern template class LockstepInterpreter<8>;
+extern template class LockstepInterpreter<16>;
+extern template class LockstepInterpreter<32>;
+
+#endif  // LOCKSTEP_HPP
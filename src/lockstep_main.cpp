@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "emulator_utils.hpp"
+#include "lockstep.hpp"
+
+namespace
+{
+const std::string LOCKSTEP_USAGE{
+    "Usage: /path/to/chip8_lockstep /path/to/rom<string> | --random-programs --machines <int>(optional, default 1024) "
+    "--lanes 8|16|32(optional, default 16) --instructions <int>(optional, default 100000) --frequency <int>(optional, "
+    "default 700) --seed <int>(optional, default 0) --cosmac(optional) --amiga(optional) --validate(optional)"};
+
+struct LockstepOptions
+{
+    std::string rom_location{};
+    bool random_programs{false};
+    std::size_t machines{1024};
+    std::size_t lanes{16};
+    std::uint64_t instructions{100000};
+    std::uint32_t cycle_frecuency{700};
+    std::uint64_t seed{0};
+    bool cosmac{false};
+    bool amiga{false};
+    bool validate{false};
+};
+
+// Parses the lockstep runner arguments. Returns -1 on error, 0 on success, and 1 if the --help option is encountered
+int parse_lockstep_arguments(int argc, char *argv[], LockstepOptions &options)
+{
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--help" || arg == "-h")
+        {
+            std::cout << "Runs many CHIP-8 machines in lockstep, optionally checking them against the scalar "
+                         "interpreter.\n"
+                      << LOCKSTEP_USAGE << std::endl;
+            return 1;
+        }
+    }
+
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+
+        if (arg == "--random-programs")
+        {
+            options.random_programs = true;
+            continue;
+        }
+        if (arg == "--cosmac")
+        {
+            options.cosmac = true;
+            continue;
+        }
+        if (arg == "--amiga")
+        {
+            options.amiga = true;
+            continue;
+        }
+        if (arg == "--validate")
+        {
+            options.validate = true;
+            continue;
+        }
+        if (arg.rfind("--", 0) != 0)
+        {
+            options.rom_location = arg;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << ".\n" << LOCKSTEP_USAGE << std::endl;
+            return -1;
+        }
+
+        std::string value{argv[++i]};
+        try
+        {
+            if (arg == "--machines")
+            {
+                options.machines = std::stoul(value);
+            }
+            else if (arg == "--lanes")
+            {
+                options.lanes = std::stoul(value);
+            }
+            else if (arg == "--instructions")
+            {
+                options.instructions = std::stoull(value);
+            }
+            else if (arg == "--frequency")
+            {
+                options.cycle_frecuency = static_cast<std::uint32_t>(std::stoul(value));
+            }
+            else if (arg == "--seed")
+            {
+                options.seed = std::stoull(value, nullptr, 0);
+            }
+            else
+            {
+                std::cerr << "Unknown argument: " << arg << ".\n" << LOCKSTEP_USAGE << std::endl;
+                return -1;
+            }
+        }
+        catch (std::logic_error &)
+        {
+            std::cerr << "Invalid " << arg << " argument.\n" << LOCKSTEP_USAGE << std::endl;
+            return -1;
+        }
+    }
+
+    if (options.rom_location.empty() == !options.random_programs)
+    {
+        std::cerr << "Exactly one of a ROM path or --random-programs is required.\n" << LOCKSTEP_USAGE << std::endl;
+        return -1;
+    }
+
+    if (options.lanes != 8 && options.lanes != 16 && options.lanes != 32)
+    {
+        std::cerr << "Invalid --lanes argument.\n" << LOCKSTEP_USAGE << std::endl;
+        return -1;
+    }
+
+    if (options.machines == 0 || options.cycle_frecuency == 0)
+    {
+        std::cerr << "Invalid --machines or --frequency argument.\n" << LOCKSTEP_USAGE << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+bool same_state(const Chip8 &a, const Chip8 &b)
+{
+    RandomGenerator random_a{a.random};
+    RandomGenerator random_b{b.random};
+
+    return a.registers == b.registers && a.pc == b.pc && a.index_register == b.index_register &&
+           a.stack_pointer == b.stack_pointer && a.stack == b.stack && a.delay_timer == b.delay_timer &&
+           a.sound_timer == b.sound_timer && a.keys == b.keys && a.key_pressed == b.key_pressed &&
+           a.display == b.display && a.memory == b.memory && a.fault.kind == b.fault.kind && a.fault.pc == b.fault.pc &&
+           a.fault.opcode == b.fault.opcode && random_a.next() == random_b.next();
+}
+
+// Runs the machine through step() with the same timer schedule as the lockstep engine. Returns the instructions
+// executed
+std::uint64_t run_scalar(Chip8 &chip8, const LockstepOptions &options)
+{
+    std::uint64_t executed{0};
+    std::uint32_t cycle_remainder{0};
+
+    while (executed < options.instructions)
+    {
+        cycle_remainder += options.cycle_frecuency;
+        std::uint64_t frame_cycles{cycle_remainder / TIMER_FREQUENCY};
+        cycle_remainder %= TIMER_FREQUENCY;
+        frame_cycles = std::min(frame_cycles, options.instructions - executed);
+
+        for (std::uint64_t i{0}; i < frame_cycles; i++)
+        {
+            if (!step(chip8))
+            {
+                return executed;
+            }
+            executed++;
+        }
+
+        tick_timers(chip8);
+    }
+
+    return executed;
+}
+
+// Runs the machines LANES at a time, storing their final state and instructions executed
+template <std::size_t LANES>
+void run_lockstep(const std::vector<Chip8> &initial,
+                  const LockstepOptions &options,
+                  std::vector<Chip8> &final,
+                  std::vector<std::uint64_t> &executed)
+{
+    for (std::size_t first{0}; first < initial.size(); first += LANES)
+    {
+        // Lanes past the last machine are never loaded and stay stopped
+        LockstepInterpreter<LANES> interpreter{};
+        const std::size_t lanes{std::min(LANES, initial.size() - first)};
+        for (std::size_t lane{0}; lane < lanes; lane++)
+        {
+            interpreter.load(lane, initial[first + lane]);
+        }
+
+        std::uint64_t done{0};
+        std::uint32_t cycle_remainder{0};
+        while (done < options.instructions)
+        {
+            cycle_remainder += options.cycle_frecuency;
+            std::uint64_t frame_cycles{cycle_remainder / TIMER_FREQUENCY};
+            cycle_remainder %= TIMER_FREQUENCY;
+            frame_cycles = std::min(frame_cycles, options.instructions - done);
+
+            interpreter.run(frame_cycles);
+            interpreter.tick_timers();
+            done += frame_cycles;
+        }
+
+        for (std::size_t lane{0}; lane < lanes; lane++)
+        {
+            interpreter.store(lane, final[first + lane]);
+            executed[first + lane] = interpreter.executed(lane);
+        }
+    }
+}
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    LockstepOptions options{};
+
+    switch (parse_lockstep_arguments(argc, argv, options))
+    {
+        case -1:
+            std::cerr << "Fatal error, execution aborted." << std::endl;
+            return EXIT_FAILURE;
+        case 1:
+            return EXIT_SUCCESS;
+        default:
+            break;
+    }
+
+    Chip8 rom_machine{};
+    if (!options.random_programs && !load_ROM(rom_machine, options.rom_location))
+    {
+        std::cerr << "Fatal error, execution aborted." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Every machine gets its own random seed, and its own program when fuzzing
+    std::vector<Chip8> initial(options.machines, rom_machine);
+    for (std::size_t machine{0}; machine < initial.size(); machine++)
+    {
+        Chip8 &chip8{initial[machine]};
+        chip8.cosmac = options.cosmac;
+        chip8.amiga = options.amiga;
+        chip8.random.seed(options.seed + machine);
+        load_font(chip8);
+        if (options.random_programs)
+        {
+            load_random_program(chip8, options.seed + machine);
+        }
+        chip8.pc = START_ADDRESS;
+    }
+
+    std::vector<Chip8> final(initial.size());
+    std::vector<std::uint64_t> executed(initial.size());
+
+    const auto start{std::chrono::steady_clock::now()};
+
+    switch (options.lanes)
+    {
+        case 8:
+            run_lockstep<8>(initial, options, final, executed);
+            break;
+        case 16:
+            run_lockstep<16>(initial, options, final, executed);
+            break;
+        default:
+            run_lockstep<32>(initial, options, final, executed);
+            break;
+    }
+
+    const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+
+    std::uint64_t total{0};
+    for (const std::uint64_t count : executed)
+    {
+        total += count;
+    }
+
+    std::cout << "lanes: " << options.lanes << "\n"
+              << "machines: " << options.machines << "\n"
+              << "instructions: " << total << "\n"
+              << "seconds: " << elapsed.count() << "\n"
+              << "instructions_per_second: " << (elapsed.count() > 0.0 ? total / elapsed.count() : 0.0) << std::endl;
+
+    if (!options.validate)
+    {
+        return EXIT_SUCCESS;
+    }
+
+    std::size_t mismatches{0};
+    std::uint64_t scalar_total{0};
+
+    const auto scalar_start{std::chrono::steady_clock::now()};
+
+    for (std::size_t machine{0}; machine < initial.size(); machine++)
+    {
+        Chip8 chip8{initial[machine]};
+        const std::uint64_t scalar_executed{run_scalar(chip8, options)};
+        scalar_total += scalar_executed;
+
+        if (scalar_executed != executed[machine] || !same_state(chip8, final[machine]))
+        {
+            if (mismatches == 0)
+            {
+                std::cerr << "Machine " << machine << " diverged from the scalar interpreter." << std::endl;
+            }
+            mismatches++;
+        }
+    }
+
+    const std::chrono::duration<double> scalar_elapsed{std::chrono::steady_clock::now() - scalar_start};
+
+    std::cout << "scalar_seconds: " << scalar_elapsed.count() << "\n"
+              << "scalar_instructions_per_second: "
+              << (scalar_elapsed.count() > 0.0 ? scalar_total / scalar_elapsed.count() : 0.0) << "\n"
+              << "mismatches: " << mismatches << std::endl;
+
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
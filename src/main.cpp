@@ -10,12 +10,13 @@ int main(int argc, char *argv[])
     QApplication application(argc, argv);
 
     Chip8 chip8{};
+    ExecutionOptions execution_options{};
 
     std::string rom_location{};
     std::uint32_t cycle_frecuency{};
     std::uint32_t window_scale{};
 
-    switch (parse_arguments(chip8, argc, argv, rom_location, cycle_frecuency, window_scale))
+    switch (parse_arguments(chip8, execution_options, argc, argv, rom_location, cycle_frecuency, window_scale))
     {
         case -1:
             std::cerr << "Fatal error, execution aborted." << std::endl;
@@ -29,6 +30,9 @@ int main(int argc, char *argv[])
     }
 
     load_font(chip8);
+    // Kept in the options so a recording stores the seed actually used
+    execution_options.seed = seed_random(chip8, execution_options);
+    std::cout << "Random seed: " << *execution_options.seed << std::endl;
 
     if (!load_ROM(chip8, rom_location))
     {
@@ -36,7 +40,7 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    Chip8EmulatorWidget emulator_widget(chip8, cycle_frecuency, window_scale);
+    Chip8EmulatorWidget emulator_widget(chip8, execution_options, cycle_frecuency, window_scale);
     emulator_widget.setWindowTitle("CHIP-8 Emulator");
     emulator_widget.show();
 
@@ -0,0 +1,30 @@
+#ifndef MEMORY_ACCESS_HPP
+#define MEMORY_ACCESS_HPP
+
+#include <cstdint>
+
+#include "chip8.hpp"
+
+// Addresses are 12 bits wide, everything above wraps around
+const std::uint32_t ADDRESS_MASK{0x0FFF};
+
+// Whether length bytes starting at address fit in memory without wrapping
+inline bool memory_range_valid(const std::uint32_t address, const std::uint32_t length)
+{
+    return address + length <= ADDRESS_MASK + 1;
+}
+
+// The memory byte at address, wrapped into the 12-bit address space so the access can't land outside memory. Without
+// wrap_memory, instructions check their whole range once before their first access and fault instead.
+// CHIP8_CHECKED_MEMORY builds check every access, throwing if an address past the end of memory got through that
+// check on a machine that doesn't wrap
+inline std::uint8_t &memory_byte(Chip8 &chip8, const std::uint32_t address)
+{
+#ifdef CHIP8_CHECKED_MEMORY
+    return chip8.memory.at(chip8.wrap_memory ? address & ADDRESS_MASK : address);
+#else
+    return chip8.memory[address & ADDRESS_MASK];
+#endif
+}
+
+#endif  // MEMORY_ACCESS_HPP
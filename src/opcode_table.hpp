@@ -0,0 +1,183 @@
+#ifndef OPCODE_TABLE_HPP
+#define OPCODE_TABLE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Instruction an opcode decodes to, in opcode order, invalid opcodes sharing the last entry
+enum class OpcodeHandler : std::uint8_t
+{
+    Op00E0,
+    Op00EE,
+    Op1NNN,
+    Op2NNN,
+    Op3XNN,
+    Op4XNN,
+    Op5XY0,
+    Op6XNN,
+    Op7XNN,
+    Op8XY0,
+    Op8XY1,
+    Op8XY2,
+    Op8XY3,
+    Op8XY4,
+    Op8XY5,
+    Op8XY6,
+    Op8XY7,
+    Op8XYE,
+    Op9XY0,
+    OpANNN,
+    OpBNNN,
+    OpCXNN,
+    OpDXYN,
+    OpEX9E,
+    OpEXA1,
+    OpFX07,
+    OpFX0A,
+    OpFX15,
+    OpFX18,
+    OpFX1E,
+    OpFX29,
+    OpFX33,
+    OpFX55,
+    OpFX65,
+    Invalid,
+};
+
+// Number of OpcodeHandler values, Invalid included
+const std::size_t OPCODE_HANDLER_COUNT{static_cast<std::size_t>(OpcodeHandler::Invalid) + 1};
+
+// A decoded opcode, with its register operands already split out
+struct OpcodeEntry
+{
+    OpcodeHandler handler{OpcodeHandler::Invalid};
+    // Second and third nibbles, the X and Y register indexes
+    std::uint8_t x{};
+    std::uint8_t y{};
+};
+
+// Decodes an opcode the slow way, only meant for building the table
+constexpr OpcodeEntry decode_opcode(const std::uint16_t opcode)
+{
+    const std::uint8_t x{static_cast<std::uint8_t>((opcode >> 8) & 0xF)};
+    const std::uint8_t y{static_cast<std::uint8_t>((opcode >> 4) & 0xF)};
+    const std::uint8_t n4{static_cast<std::uint8_t>(opcode & 0xF)};
+    const std::uint8_t low_byte{static_cast<std::uint8_t>(opcode & 0xFF)};
+
+    OpcodeHandler handler{OpcodeHandler::Invalid};
+    switch (opcode >> 12)
+    {
+        case 0x0:
+            // 0NNN not implemented
+            handler = opcode == 0x00E0   ? OpcodeHandler::Op00E0
+                      : opcode == 0x00EE ? OpcodeHandler::Op00EE
+                                         : OpcodeHandler::Invalid;
+            break;
+        case 0x5:
+            handler = n4 == 0x0 ? OpcodeHandler::Op5XY0 : OpcodeHandler::Invalid;
+            break;
+        case 0x8:
+            if (n4 <= 0x7)
+            {
+                handler = static_cast<OpcodeHandler>(static_cast<std::uint8_t>(OpcodeHandler::Op8XY0) + n4);
+            }
+            else if (n4 == 0xE)
+            {
+                handler = OpcodeHandler::Op8XYE;
+            }
+            break;
+        case 0x9:
+            handler = n4 == 0x0 ? OpcodeHandler::Op9XY0 : OpcodeHandler::Invalid;
+            break;
+        case 0xE:
+            handler = low_byte == 0x9E   ? OpcodeHandler::OpEX9E
+                      : low_byte == 0xA1 ? OpcodeHandler::OpEXA1
+                                         : OpcodeHandler::Invalid;
+            break;
+        case 0xF:
+            switch (low_byte)
+            {
+                case 0x07:
+                    handler = OpcodeHandler::OpFX07;
+                    break;
+                case 0x0A:
+                    handler = OpcodeHandler::OpFX0A;
+                    break;
+                case 0x15:
+                    handler = OpcodeHandler::OpFX15;
+                    break;
+                case 0x18:
+                    handler = OpcodeHandler::OpFX18;
+                    break;
+                case 0x1E:
+                    handler = OpcodeHandler::OpFX1E;
+                    break;
+                case 0x29:
+                    handler = OpcodeHandler::OpFX29;
+                    break;
+                case 0x33:
+                    handler = OpcodeHandler::OpFX33;
+                    break;
+                case 0x55:
+                    handler = OpcodeHandler::OpFX55;
+                    break;
+                case 0x65:
+                    handler = OpcodeHandler::OpFX65;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        default:
+        {
+            // 1NNN to 4XNN, 6XNN, 7XNN and ANNN to DXYN take every value of their operands
+            const std::array<OpcodeHandler, 16> whole_families{
+                OpcodeHandler::Invalid, OpcodeHandler::Op1NNN, OpcodeHandler::Op2NNN, OpcodeHandler::Op3XNN,
+                OpcodeHandler::Op4XNN,  OpcodeHandler::Invalid, OpcodeHandler::Op6XNN, OpcodeHandler::Op7XNN,
+                OpcodeHandler::Invalid, OpcodeHandler::Invalid, OpcodeHandler::OpANNN, OpcodeHandler::OpBNNN,
+                OpcodeHandler::OpCXNN,  OpcodeHandler::OpDXYN,  OpcodeHandler::Invalid, OpcodeHandler::Invalid};
+            handler = whole_families[opcode >> 12];
+            break;
+        }
+    }
+
+    return {handler, x, y};
+}
+
+// The opcodes whose high byte is HIGH. Every page is its own constant, so no single constant evaluation decodes
+// more than 256 opcodes and the table stays within the compilers' default constexpr step limits
+template <std::uint8_t HIGH>
+constexpr std::array<OpcodeEntry, 256> make_opcode_page()
+{
+    std::array<OpcodeEntry, 256> page{};
+    for (std::size_t low{0}; low < page.size(); low++)
+    {
+        page[low] = decode_opcode(static_cast<std::uint16_t>(HIGH << 8 | low));
+    }
+
+    return page;
+}
+
+template <std::uint8_t HIGH>
+inline constexpr std::array<OpcodeEntry, 256> OPCODE_PAGE{make_opcode_page<HIGH>()};
+
+template <std::size_t... HIGH>
+constexpr std::array<std::array<OpcodeEntry, 256>, 256> make_opcode_table(std::index_sequence<HIGH...>)
+{
+    return {{OPCODE_PAGE<static_cast<std::uint8_t>(HIGH)>...}};
+}
+
+// Every opcode decoded at compile time. The pages are laid out back to back, so looking an opcode up is a single
+// indexed load
+inline constexpr std::array<std::array<OpcodeEntry, 256>, 256> OPCODE_TABLE{
+    make_opcode_table(std::make_index_sequence<256>{})};
+
+// Returns the decoded form of an opcode
+inline const OpcodeEntry &opcode_entry(const std::uint16_t opcode)
+{
+    return OPCODE_TABLE[opcode >> 8][opcode & 0xFF];
+}
+
+#endif  // OPCODE_TABLE_HPP
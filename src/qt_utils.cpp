@@ -2,36 +2,56 @@
 
 #include <QAudioDevice>
 #include <QAudioSink>
-#include <QBuffer>
+#include <QImage>
 #include <QKeyEvent>
 #include <QMediaDevices>
+#include <QPaintEvent>
 #include <QPainter>
+#include <QSettings>
+#include <QString>
 #include <QTimer>
-#include <cmath>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 #include "chip8_constants.hpp"
 #include "emulator_utils.hpp"
+#include "tone_generator.hpp"
+
+namespace
+{
+// Where the audio device and format found by probing are remembered between launches
+const char *const AUDIO_CONFIG_ORGANIZATION{"chip8-emulator"};
+const char *const AUDIO_CONFIG_NAME{"audio"};
+}  // namespace
 
 Chip8EmulatorWidget::Chip8EmulatorWidget(Chip8 &chip8,
+                                         const ExecutionOptions &execution_options,
                                          const std::uint32_t cycle_frecuency,
                                          const std::uint32_t window_scale,
                                          QWidget *parent) :
     QWidget(parent),
     chip8(chip8),
+    emulator(chip8, execution_options, cycle_frecuency),
     cycle_frecuency(cycle_frecuency),
     window_scale(window_scale),
-    cpu_timer(nullptr),
-    standard_timer(nullptr),
+    frame_image(WINDOW_WIDTH, WINDOW_HEIGHT, QImage::Format_RGB32),
+    frame_timer(nullptr),
     audio_sink(nullptr),
-    audio_buffer(nullptr),
-    sound_playing(false)
+    tone_generator(nullptr),
+    audio_buffer_ms(execution_options.audio_buffer_ms)
 {
+    startup_timer.start();
+
     chip8.pc = START_ADDRESS;
 
     setup_display();
     setup_timers();
-    setup_audio();
+
+    if (!execution_options.mute)
+    {
+        audio_probe = std::thread(&Chip8EmulatorWidget::setup_audio, this);
+    }
 
     setFocusPolicy(Qt::StrongFocus);
 
@@ -40,20 +60,23 @@ Chip8EmulatorWidget::Chip8EmulatorWidget(Chip8 &chip8,
 
 Chip8EmulatorWidget::~Chip8EmulatorWidget()
 {
-    if (cpu_timer)
+    // Waits for a probe still running, an output it found that has not started yet is dropped along with the widget
+    if (audio_probe.joinable())
     {
-        cpu_timer->stop();
+        audio_probe.join();
     }
 
-    if (standard_timer)
+    if (frame_timer)
     {
-        standard_timer->stop();
+        frame_timer->stop();
     }
 
-    stop_audio();
+    if (audio_sink)
+    {
+        audio_sink->stop();
+    }
 
-    delete audio_sink;
-    delete audio_buffer;
+    emulator.stop();
 }
 
 void Chip8EmulatorWidget::setup_display()
@@ -63,38 +86,139 @@ void Chip8EmulatorWidget::setup_display()
     setWindowTitle("CHIP-8 Emulator");
 
     setStyleSheet("background-color: black;");
+
+    // paintEvent covers every pixel it is asked to repaint, so Qt doesn't need to clear the background first
+    setAttribute(Qt::WA_OpaquePaintEvent);
+
+    present_rows(0xFFFFFFFF);
 }
 
-void Chip8EmulatorWidget::setup_timers()
+void Chip8EmulatorWidget::present_rows(const std::uint32_t rows)
 {
-    cpu_timer = new QTimer(this);
-    cpu_timer->setInterval(1000 / cycle_frecuency);
+    std::uint32_t first_row{WINDOW_HEIGHT};
+    std::uint32_t last_row{0};
+
+    for (std::uint32_t y = 0; y < WINDOW_HEIGHT; y++)
+    {
+        if ((rows >> y & 0x1) == 0)
+        {
+            continue;
+        }
+
+        const std::uint64_t row{presented_display[y]};
+        QRgb *pixels{reinterpret_cast<QRgb *>(frame_image.scanLine(y))};
+        for (std::uint32_t x = 0; x < WINDOW_WIDTH; x++)
+        {
+            pixels[x] = (row >> (WINDOW_WIDTH - 1 - x) & 0x1) != 0 ? 0xFFFFFFFF : 0xFF000000;
+        }
 
-    connect(cpu_timer, &QTimer::timeout, this, &Chip8EmulatorWidget::execute_cycle);
+        first_row = std::min(first_row, y);
+        last_row = y;
+    }
 
-    standard_timer = new QTimer(this);
-    standard_timer->setInterval(1000 / TIMER_FREQUENCY);
+    if (first_row < WINDOW_HEIGHT)
+    {
+        update(QRect(0, first_row * window_scale, width(), (last_row - first_row + 1) * window_scale));
+    }
+}
+
+void Chip8EmulatorWidget::setup_timers()
+{
+    // Emulation runs on its own thread at its own pace, this timer only picks up the frames it publishes
+    frame_timer = new QTimer(this);
+    frame_timer->setTimerType(Qt::PreciseTimer);
+    frame_timer->setInterval(1000 / TIMER_FREQUENCY);
 
-    connect(standard_timer, &QTimer::timeout, this, &Chip8EmulatorWidget::update_timers);
+    connect(frame_timer, &QTimer::timeout, this, &Chip8EmulatorWidget::present_frame);
 
-    cpu_timer->start();
-    standard_timer->start();
+    emulator.start();
+    frame_timer->start();
 }
 
-// TODO: Simplify this
 void Chip8EmulatorWidget::setup_audio()
+{
+    QElapsedTimer setup_timer;
+    setup_timer.start();
+
+    QAudioDevice device{};
+    QAudioFormat format{};
+    const bool cached{load_audio_config(device, format)};
+    if (!cached && !find_audio_output(device, format))
+    {
+        std::cout << "No compatible audio device found - sound disabled" << std::endl;
+        return;
+    }
+
+    if (!cached)
+    {
+        save_audio_config(device, format);
+    }
+
+    // The sink and the tone generator belong to the widget, so they are created on the GUI thread
+    const qint64 setup_ms{setup_timer.elapsed()};
+    QMetaObject::invokeMethod(
+        this,
+        [this, device, format, cached, setup_ms]()
+        {
+            start_audio(device, format);
+            std::cout << "Audio ready: " << device.description().toStdString() << " with " << format.sampleRate()
+                      << "Hz, " << format.channelCount() << " channels, format "
+                      << static_cast<int>(format.sampleFormat()) << (cached ? " (cached)" : "") << " in " << setup_ms
+                      << "ms" << std::endl;
+        },
+        Qt::QueuedConnection);
+}
+
+bool Chip8EmulatorWidget::load_audio_config(QAudioDevice &device, QAudioFormat &format)
+{
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, AUDIO_CONFIG_ORGANIZATION, AUDIO_CONFIG_NAME);
+    const QByteArray device_id{settings.value("device").toByteArray()};
+    if (device_id.isEmpty())
+    {
+        return false;
+    }
+
+    format.setSampleRate(settings.value("sample_rate").toInt());
+    format.setChannelCount(settings.value("channels").toInt());
+    format.setSampleFormat(static_cast<QAudioFormat::SampleFormat>(settings.value("sample_format").toInt()));
+
+    // A single check instead of probing, the device may have been unplugged or reconfigured since
+    for (const QAudioDevice &output : QMediaDevices::audioOutputs())
+    {
+        if (output.id() == device_id && output.isFormatSupported(format))
+        {
+            device = output;
+            return true;
+        }
+    }
+
+    std::cout << "Cached audio device unavailable, probing again..." << std::endl;
+    return false;
+}
+
+void Chip8EmulatorWidget::save_audio_config(const QAudioDevice &device, const QAudioFormat &format)
+{
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, AUDIO_CONFIG_ORGANIZATION, AUDIO_CONFIG_NAME);
+    settings.setValue("device", device.id());
+    settings.setValue("sample_rate", format.sampleRate());
+    settings.setValue("channels", format.channelCount());
+    settings.setValue("sample_format", static_cast<int>(format.sampleFormat()));
+}
+
+bool Chip8EmulatorWidget::find_audio_output(QAudioDevice &device, QAudioFormat &format)
 {
     // Use the system's default output device
     QAudioDevice default_device = QMediaDevices::defaultAudioOutput();
 
-    if (default_device.isNull())
+    // The preferred format is supported by definition, and the tone generator can produce every sample format
+    if (!default_device.isNull() && default_device.preferredFormat().isValid())
     {
-        std::cout << "No default audio device found - sound disabled" << std::endl;
-        chip8.mute = true;
-        return;
+        device = default_device;
+        format = default_device.preferredFormat();
+        return true;
     }
 
-    std::cout << "Using default audio device: " << default_device.description().toStdString() << std::endl;
+    std::cout << "Default audio device unusable, probing formats..." << std::endl;
 
     // Try many more formats
     QList<QAudioFormat> formats;
@@ -110,154 +234,144 @@ void Chip8EmulatorWidget::setup_audio()
     {
         for (int channels : channel_counts)
         {
-            for (QAudioFormat::SampleFormat format : sample_formats)
+            for (QAudioFormat::SampleFormat sample_format : sample_formats)
             {
                 QAudioFormat audio_format;
                 audio_format.setSampleRate(rate);
                 audio_format.setChannelCount(channels);
-                audio_format.setSampleFormat(format);
+                audio_format.setSampleFormat(sample_format);
                 formats.append(audio_format);
             }
         }
     }
 
-    // Try formats on the default device
-    for (const QAudioFormat &format : formats)
+    for (const QAudioDevice &output : QMediaDevices::audioOutputs())
     {
-        if (default_device.isFormatSupported(format))
+        if (output.isNull())
         {
-            audio_sink = new QAudioSink(default_device, format, this);
-            audio_sink->setVolume(0.4);
-            audio_data = generate_beep(format);
-
-            std::cout << "Audio ready with format: " << format.sampleRate() << "Hz, " << format.channelCount()
-                      << " channels, format " << static_cast<int>(format.sampleFormat()) << std::endl;
-            return;
+            continue;
         }
-    }
 
-    // If default device doesn't work, fall back to trying all devices
-    std::cout << "Default device doesn't support any tested formats, trying others..." << std::endl;
+        std::cout << "Trying: " << output.description().toStdString() << std::endl;
 
-    for (const QAudioDevice &device : QMediaDevices::audioOutputs())
-    {
-        if (device.isNull() || device == default_device)
+        for (const QAudioFormat &audio_format : formats)
         {
-            continue;  // Skip default (already tried)
-        }
-
-
-        std::cout << "Trying: " << device.description().toStdString() << std::endl;
-
-        for (const QAudioFormat &format : formats)
-        {
-            if (device.isFormatSupported(format))
+            if (output.isFormatSupported(audio_format))
             {
-                audio_sink = new QAudioSink(device, format, this);
-                audio_sink->setVolume(0.4);
-                audio_data = generate_beep(format);
-
-                std::cout << "Audio ready: " << device.description().toStdString() << " with " << format.sampleRate()
-                          << "Hz" << std::endl;
-                return;
+                device = output;
+                format = audio_format;
+                return true;
             }
         }
     }
 
-    std::cout << "No compatible audio device found - sound disabled" << std::endl;
-    chip8.mute = true;
+    return false;
 }
 
-void Chip8EmulatorWidget::start_audio()
+void Chip8EmulatorWidget::start_audio(const QAudioDevice &device, const QAudioFormat &format)
 {
-    if (!audio_sink || audio_data.isEmpty())
-    {
-        return;
-    }
-
-    stop_audio();
-
-    audio_buffer = new QBuffer(&audio_data, this);
-    audio_buffer->open(QIODevice::ReadOnly);
-
-    audio_sink->start(audio_buffer);
-
-    sound_playing = true;
+    audio_sink = new QAudioSink(device, format, this);
+    audio_sink->setVolume(0.4);
+    // The tone is synthesized as the sink pulls it, so a short buffer is all that stands between a beep and the
+    // speakers
+    audio_sink->setBufferSize(format.bytesForDuration(static_cast<qint64>(audio_buffer_ms) * 1000));
+
+    tone_generator = new ToneGenerator(emulator, format, this);
+    tone_generator->open(QIODevice::ReadOnly);
+    audio_sink->start(tone_generator);
 }
 
-void Chip8EmulatorWidget::stop_audio()
+void Chip8EmulatorWidget::present_frame()
 {
-    if (audio_sink && sound_playing)
+    if (emulator.failed())
     {
-        audio_sink->stop();
-        sound_playing = false;
+        std::cerr << "Fatal error, execution aborted." << std::endl;
+        frame_timer->stop();
+        close();
+        return;
     }
 
-    if (audio_buffer)
+    update_frame_stats();
+
+    if (!emulator.acquire_frame())
     {
-        audio_buffer->close();
-        delete audio_buffer;
-        audio_buffer = nullptr;
+        return;
     }
-}
+    presented_frames++;
 
-void Chip8EmulatorWidget::execute_cycle()
-{
-    std::uint16_t opcode = chip8.memory.at(chip8.pc) << 8 | chip8.memory.at(chip8.pc + 1);
-    chip8.pc += 2;
-
-    if (!execute(chip8, opcode))
+    // Frames published while the GUI was busy are skipped, so compare against what is on screen rather than relying
+    // on the emulator's dirty rows
+    const EmulatorThread::Frame &frame{emulator.frame()};
+    std::uint32_t changed_rows{0};
+    for (std::uint32_t y = 0; y < WINDOW_HEIGHT; y++)
     {
-        std::cerr << "Fatal error, execution aborted." << std::endl;
-        close();
-        return;
+        if (frame.display[y] != presented_display[y])
+        {
+            presented_display[y] = frame.display[y];
+            changed_rows |= 1u << y;
+        }
     }
 
-    if (chip8.render)
+    present_rows(changed_rows);
+
+    if (frame.input_time != CycleScheduler::clock::time_point{})
     {
-        update();
-        chip8.render = false;
+        const std::chrono::duration<double, std::milli> latency{CycleScheduler::clock::now() - frame.input_time};
+        input_latency_ms += latency.count();
+        max_input_latency_ms = std::max(max_input_latency_ms, latency.count());
+        input_events++;
     }
 }
 
-void Chip8EmulatorWidget::update_timers()
+void Chip8EmulatorWidget::update_frame_stats()
 {
-    if (chip8.delay_timer > 0)
+    // Refresh once a second, with the frames shown during it and the ones dropped since start
+    if (++stats_ticks < TIMER_FREQUENCY)
     {
-        chip8.delay_timer--;
+        return;
     }
 
-    if (chip8.sound_timer > 0)
-    {
-        if (!chip8.mute && !sound_playing)
-        {
-            start_audio();
-        }
-        chip8.sound_timer--;
-    }
-    else if (sound_playing)
+    const EmulatorThread::FrameStats stats{emulator.frame_stats()};
+    QString title{QString("CHIP-8 Emulator - %1 fps, %2 dropped").arg(presented_frames).arg(stats.dropped)};
+    if (input_events > 0)
     {
-        stop_audio();
+        title += QString(", input %1ms avg %2ms max")
+                     .arg(input_latency_ms / input_events, 0, 'f', 1)
+                     .arg(max_input_latency_ms, 0, 'f', 1);
     }
+    setWindowTitle(title);
+
+    stats_ticks = 0;
+    presented_frames = 0;
+    input_events = 0;
+    input_latency_ms = 0.0;
+    max_input_latency_ms = 0.0;
 }
 
 void Chip8EmulatorWidget::paintEvent(QPaintEvent *event)
 {
-    Q_UNUSED(event);
+    // Repaint whole rows covering the invalidated area, straight from the cached image
+    const QRect area{event->rect()};
+    const int first_row{std::max(0, area.top() / static_cast<int>(window_scale))};
+    const int last_row{std::min(static_cast<int>(WINDOW_HEIGHT) - 1, area.bottom() / static_cast<int>(window_scale))};
+    if (first_row > last_row)
+    {
+        return;
+    }
 
+    const int row_count{last_row - first_row + 1};
+
+    // Scaled with Qt::FastTransformation semantics, nearest neighbour, so the pixels stay sharp
     QPainter painter(this);
-    painter.fillRect(rect(), Qt::black);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, false);
+    painter.drawImage(QRect(0, first_row * window_scale, width(), row_count * window_scale),
+                      frame_image,
+                      QRect(0, first_row, WINDOW_WIDTH, row_count));
 
-    for (std::uint32_t x = 0; x < WINDOW_WIDTH; x++)
+    if (!first_frame_shown)
     {
-        for (std::uint32_t y = 0; y < WINDOW_HEIGHT; y++)
-        {
-            if (chip8.display.at(x + y * WINDOW_WIDTH) != 0)
-            {
-                QRect pixel(x * window_scale, y * window_scale, window_scale, window_scale);
-                painter.fillRect(pixel, Qt::white);
-            }
-        }
+        first_frame_shown = true;
+        std::cout << "Time to first frame: " << startup_timer.elapsed() << "ms" << std::endl;
     }
 }
 
@@ -271,7 +385,10 @@ void Chip8EmulatorWidget::keyPressEvent(QKeyEvent *event)
     int chip8_key = map_qt_key_to_chip8(event->key());
     if (chip8_key != -1)
     {
-        chip8.keys.at(chip8_key) = 0x1;
+        if (!emulator.set_key(static_cast<std::uint8_t>(chip8_key), true))
+        {
+            std::cerr << "Input queue full, key press dropped." << std::endl;
+        }
         event->accept();
     }
 }
@@ -286,7 +403,10 @@ void Chip8EmulatorWidget::keyReleaseEvent(QKeyEvent *event)
     int chip8_key = map_qt_key_to_chip8(event->key());
     if (chip8_key != -1)
     {
-        chip8.keys.at(chip8_key) = 0x0;
+        if (!emulator.set_key(static_cast<std::uint8_t>(chip8_key), false))
+        {
+            std::cerr << "Input queue full, key release dropped." << std::endl;
+        }
         event->accept();
     }
 }
@@ -331,70 +451,3 @@ int Chip8EmulatorWidget::map_qt_key_to_chip8(const int qt_key)
             return -1;
     }
 }
-
-// TODO: Double check this
-QByteArray generate_beep(const QAudioFormat &format, const int duration_ms)
-{
-    qint64 num_samples = (format.sampleRate() * duration_ms) / 1000;
-    QByteArray buffer;
-    const qreal freq = 2.0 * M_PI * 440.0 / format.sampleRate();  // 440Hz
-
-    if (format.sampleFormat() == QAudioFormat::Float)
-    {
-        buffer.resize(num_samples * format.channelCount() * sizeof(float));
-        float *data = reinterpret_cast<float *>(buffer.data());
-
-        for (qint64 i = 0; i < num_samples; ++i)
-        {
-            float value = static_cast<float>(std::sin(i * freq) * 0.3);
-            for (int ch = 0; ch < format.channelCount(); ++ch)
-            {
-                data[i * format.channelCount() + ch] = value;
-            }
-        }
-    }
-    else if (format.sampleFormat() == QAudioFormat::Int32)
-    {
-        buffer.resize(num_samples * format.channelCount() * sizeof(qint32));
-        qint32 *data = reinterpret_cast<qint32 *>(buffer.data());
-
-        for (qint64 i = 0; i < num_samples; ++i)
-        {
-            qint32 value = static_cast<qint32>(std::sin(i * freq) * 200000000);  // 32-bit range
-            for (int ch = 0; ch < format.channelCount(); ++ch)
-            {
-                data[i * format.channelCount() + ch] = value;
-            }
-        }
-    }
-    else if (format.sampleFormat() == QAudioFormat::Int16)
-    {
-        buffer.resize(num_samples * format.channelCount() * sizeof(qint16));
-        qint16 *data = reinterpret_cast<qint16 *>(buffer.data());
-
-        for (qint64 i = 0; i < num_samples; ++i)
-        {
-            qint16 value = static_cast<qint16>(std::sin(i * freq) * 8000);
-            for (int ch = 0; ch < format.channelCount(); ++ch)
-            {
-                data[i * format.channelCount() + ch] = value;
-            }
-        }
-    }
-    else  // UInt8
-    {
-        buffer.resize(num_samples * format.channelCount() * sizeof(quint8));
-        quint8 *data = reinterpret_cast<quint8 *>(buffer.data());
-
-        for (qint64 i = 0; i < num_samples; ++i)
-        {
-            quint8 value = static_cast<quint8>((std::sin(i * freq) + 1.0) * 96);
-            for (int ch = 0; ch < format.channelCount(); ++ch)
-            {
-                data[i * format.channelCount() + ch] = value;
-            }
-        }
-    }
-
-    return buffer;
-}
@@ -1,15 +1,20 @@
 #ifndef QT_UTILS_HPP
 #define QT_UTILS_HPP
 
+#include <QElapsedTimer>
+#include <QImage>
 #include <QWidget>
+#include <thread>
 
 #include "chip8.hpp"
+#include "emulator_thread.hpp"
+#include "emulator_utils.hpp"
 
+class QAudioDevice;
 class QAudioFormat;
 class QAudioSink;
-class QBuffer;
-class QByteArray;
 class QTimer;
+class ToneGenerator;
 
 // Qt-based widget that handles display rendering, input processing, and audio output
 class Chip8EmulatorWidget : public QWidget
@@ -17,8 +22,10 @@ class Chip8EmulatorWidget : public QWidget
     Q_OBJECT
 
 public:
-    // Creates the emulator widget with the specified CHIP-8 instance, cycle frequency, and window scale
+    // Creates the emulator widget with the specified CHIP-8 instance, execution options, cycle frequency, and window
+    // scale
     explicit Chip8EmulatorWidget(Chip8 &chip8,
+                                 const ExecutionOptions &execution_options,
                                  std::uint32_t cycle_frecuency,
                                  std::uint32_t window_scale,
                                  QWidget *parent = nullptr);
@@ -34,42 +41,61 @@ protected:
     void keyReleaseEvent(QKeyEvent *event) override;
 
 private slots:
-    // Executes one CHIP-8 CPU cycle
-    void execute_cycle();
-    // Updates the delay and sound timers at 60Hz
-    void update_timers();
+    // Presents the newest frame published by the emulator thread
+    void present_frame();
 
 private:
     Chip8 &chip8;
+    EmulatorThread emulator;
     std::uint32_t cycle_frecuency;
     std::uint32_t window_scale;
 
-    QTimer *cpu_timer;
-    QTimer *standard_timer;
+    // The display rows currently shown, and the same rows expanded to one RGB32 pixel per CHIP-8 pixel
+    std::array<std::uint64_t, WINDOW_HEIGHT> presented_display{};
+    QImage frame_image;
 
-    QAudioSink *audio_sink;
-    QBuffer *audio_buffer;
-    QByteArray audio_data;
+    QTimer *frame_timer;
+    // Presentation timer ticks, frames shown, and key event to present latencies since the window title was last
+    // refreshed
+    std::uint32_t stats_ticks{0};
+    std::uint32_t presented_frames{0};
+    std::uint32_t input_events{0};
+    double input_latency_ms{0.0};
+    double max_input_latency_ms{0.0};
+
+    // Measures the time to the first frame shown
+    QElapsedTimer startup_timer;
+    bool first_frame_shown{false};
 
-    bool sound_playing;
+    QAudioSink *audio_sink;
+    ToneGenerator *tone_generator;
+    std::uint32_t audio_buffer_ms;
+    // Looks for an audio output while the game starts, probing never runs on the GUI thread
+    std::thread audio_probe;
 
     // Configures the widget display properties
     void setup_display();
-    // Initializes CPU and timer update timers
+    // Converts the presented display rows set in rows into frame_image and invalidates the widget area covering them
+    void present_rows(std::uint32_t rows);
+    // Initializes the presentation timer and starts the emulator thread
     void setup_timers();
-    // Sets up audio output with compatible format detection
+    // Runs on audio_probe. Finds the device and format cached by a previous launch, probing for them if there are none,
+    // then has the GUI thread start audio output on them
     void setup_audio();
-
-    // Starts audio playback
-    void start_audio();
-    // Stops audio playback and cleans up audio buffer
-    void stop_audio();
+    // Loads the cached audio device and format. Returns false if there are none or they are no longer usable
+    bool load_audio_config(QAudioDevice &device, QAudioFormat &format);
+    // Caches the audio device and format for the next launches
+    void save_audio_config(const QAudioDevice &device, const QAudioFormat &format);
+    // Probes for an output device and a format it supports. Returns false if none is found
+    bool find_audio_output(QAudioDevice &device, QAudioFormat &format);
+    // Starts streaming the beep to the given device, which must support the format
+    void start_audio(const QAudioDevice &device, const QAudioFormat &format);
+
+    // Shows the presented frame rate, the dropped frame count and the input latency in the window title
+    void update_frame_stats();
 
     // Maps Qt key codes to CHIP-8 keypad values. Returns -1 for unmapped keys
     int map_qt_key_to_chip8(int qt_key);
 };
 
-// Generates a simple beep tone for the given audio format
-QByteArray generate_beep(const QAudioFormat &format, const int duration_ms = 500);
-
 #endif  // QT_UTILS_HPP
\ No newline at end of file
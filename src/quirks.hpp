@@ -0,0 +1,98 @@
+#ifndef QUIRKS_HPP
+#define QUIRKS_HPP
+
+#include "chip8.hpp"
+
+// Quirk profiles, the platform behaviours of the instructions that differ between CHIP-8 implementations. Handlers
+// and dispatch loops are templated on a profile so its behaviours are resolved at compile time. A new profile
+// derives from the closest existing one, overrides the behaviours that differ, and is added to QuirkProfile,
+// quirk_profile(), with_quirk_profile() and CHIP8_FOR_EACH_QUIRK_PROFILE
+
+// CHIP-48 and most modern interpreters, what ROMs written today expect
+struct ModernQuirks
+{
+    // 8XY1, 8XY2 and 8XY3 reset VF
+    static constexpr bool logic_resets_vf{false};
+    // 8XY6 and 8XYE shift VY into VX instead of shifting VX in place
+    static constexpr bool shift_reads_vy{false};
+    // BNNN jumps to NNN + V0 instead of XNN + VX
+    static constexpr bool jump_reads_v0{false};
+    // DXYN clips sprites at the display edges instead of wrapping them around
+    static constexpr bool clip_sprites{false};
+    // FX0A waits for the key to be released before storing it
+    static constexpr bool wait_for_release{false};
+    // FX55 and FX65 leave I pointing past the last register stored or loaded
+    static constexpr bool load_store_increments_index{false};
+    // FX1E sets VF when I overflows past 0xFFF
+    static constexpr bool index_overflow_sets_vf{false};
+};
+
+// The original COSMAC VIP interpreter, selected with --cosmac
+struct CosmacQuirks : ModernQuirks
+{
+    static constexpr bool logic_resets_vf{true};
+    static constexpr bool shift_reads_vy{true};
+    static constexpr bool jump_reads_v0{true};
+    static constexpr bool clip_sprites{true};
+    static constexpr bool wait_for_release{true};
+    static constexpr bool load_store_increments_index{true};
+};
+
+// The Amiga interpreter, selected with --amiga
+struct AmigaQuirks : ModernQuirks
+{
+    static constexpr bool index_overflow_sets_vf{true};
+};
+
+// --cosmac and --amiga together
+struct CosmacAmigaQuirks : CosmacQuirks
+{
+    static constexpr bool index_overflow_sets_vf{true};
+};
+
+// Runtime tag of a quirk profile
+enum class QuirkProfile
+{
+    Modern,
+    Cosmac,
+    Amiga,
+    CosmacAmiga,
+};
+
+// The profile matching the machine's quirk flags
+inline QuirkProfile quirk_profile(const Chip8 &chip8)
+{
+    if (chip8.cosmac)
+    {
+        return chip8.amiga ? QuirkProfile::CosmacAmiga : QuirkProfile::Cosmac;
+    }
+
+    return chip8.amiga ? QuirkProfile::Amiga : QuirkProfile::Modern;
+}
+
+// Calls function with a default constructed value of the profile's type, the single runtime branch choosing which
+// specialization runs
+template <typename Function>
+decltype(auto) with_quirk_profile(const QuirkProfile profile, Function &&function)
+{
+    switch (profile)
+    {
+        case QuirkProfile::Cosmac:
+            return function(CosmacQuirks{});
+        case QuirkProfile::Amiga:
+            return function(AmigaQuirks{});
+        case QuirkProfile::CosmacAmiga:
+            return function(CosmacAmigaQuirks{});
+        default:
+            return function(ModernQuirks{});
+    }
+}
+
+// Expands MACRO(profile type) for every profile, to explicitly instantiate the templates defined in source files
+#define CHIP8_FOR_EACH_QUIRK_PROFILE(MACRO) \
+    MACRO(ModernQuirks)                     \
+    MACRO(CosmacQuirks)                     \
+    MACRO(AmigaQuirks)                      \
+    MACRO(CosmacAmigaQuirks)
+
+#endif  // QUIRKS_HPP
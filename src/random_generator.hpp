@@ -0,0 +1,58 @@
+#ifndef RANDOM_GENERATOR_HPP
+#define RANDOM_GENERATOR_HPP
+
+#include <array>
+#include <cstdint>
+
+// xoshiro128** generator, small enough to live inside the emulator state and copy along with it. The same seed always
+// produces the same sequence, on every platform
+class RandomGenerator
+{
+public:
+    RandomGenerator()
+    {
+        seed(0);
+    }
+
+    // Restarts the sequence from the given seed, expanded into the full state with splitmix64
+    void seed(std::uint64_t value)
+    {
+        for (std::size_t i{0}; i < state.size(); i += 2)
+        {
+            value += 0x9E3779B97F4A7C15;
+            std::uint64_t mixed{value};
+            mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9;
+            mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EB;
+            mixed ^= mixed >> 31;
+
+            state[i] = static_cast<std::uint32_t>(mixed);
+            state[i + 1] = static_cast<std::uint32_t>(mixed >> 32);
+        }
+    }
+
+    // Returns the next 32 random bits
+    std::uint32_t next()
+    {
+        const std::uint32_t result{rotate_left(state[1] * 5, 7) * 9};
+        const std::uint32_t shifted{state[1] << 9};
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = rotate_left(state[3], 11);
+
+        return result;
+    }
+
+private:
+    std::array<std::uint32_t, 4> state{};
+
+    static std::uint32_t rotate_left(const std::uint32_t value, const int bits)
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+};
+
+#endif  // RANDOM_GENERATOR_HPP
@@ -0,0 +1,35 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+
+namespace
+{
+const std::uint64_t NANOSECONDS_PER_SECOND{1000000000};
+}
+
+CycleScheduler::CycleScheduler(const std::uint64_t frequency) :
+    cycle_frequency(frequency),
+    last_time(clock::now()),
+    remainder(0)
+{
+}
+
+void CycleScheduler::reset(const clock::time_point now)
+{
+    last_time = now;
+    remainder = 0;
+}
+
+std::uint64_t CycleScheduler::advance(const clock::time_point now)
+{
+    std::chrono::nanoseconds elapsed{std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_time)};
+    last_time = now;
+
+    elapsed = std::clamp(elapsed, std::chrono::nanoseconds::zero(), MAX_CATCH_UP);
+
+    // At most 250ms * rate, which fits comfortably in 64 bits for any realistic rate
+    const std::uint64_t scaled{static_cast<std::uint64_t>(elapsed.count()) * cycle_frequency + remainder};
+    remainder = scaled % NANOSECONDS_PER_SECOND;
+
+    return scaled / NANOSECONDS_PER_SECOND;
+}
@@ -0,0 +1,38 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <chrono>
+#include <cstdint>
+
+// Converts monotonic host time into a whole number of cycles at a fixed rate. The fractional part of every
+// conversion is carried over, so the long term average matches the target rate exactly
+class CycleScheduler
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    // Creates a scheduler for the given rate, in cycles per second
+    explicit CycleScheduler(std::uint64_t frequency);
+
+    // Restarts the accounting at the given time, dropping any pending fraction
+    void reset(clock::time_point now);
+
+    // Returns the number of cycles due between the previous call and now. Elapsed time is clamped to
+    // MAX_CATCH_UP so a long host stall doesn't trigger a burst of catch-up work
+    std::uint64_t advance(clock::time_point now);
+
+    std::uint64_t frequency() const
+    {
+        return cycle_frequency;
+    }
+
+    static constexpr std::chrono::nanoseconds MAX_CATCH_UP{std::chrono::milliseconds(250)};
+
+private:
+    std::uint64_t cycle_frequency;
+    clock::time_point last_time;
+    // Pending fraction of a cycle, in units of 1/1e9 cycles
+    std::uint64_t remainder;
+};
+
+#endif  // SCHEDULER_HPP
@@ -0,0 +1,57 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Lock-free bounded queue between one producer thread and one consumer thread. Capacity must be a power of two, and
+// one slot is always left free to tell a full queue from an empty one
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer side, appends a value. Returns false if the queue is full
+    bool push(const T &value)
+    {
+        const std::size_t tail_index{tail.load(std::memory_order_relaxed)};
+        const std::size_t next{(tail_index + 1) & (Capacity - 1)};
+        if (next == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        values[tail_index] = value;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, the oldest value, or nullptr if the queue is empty. Stays valid until pop()
+    const T *front() const
+    {
+        const std::size_t head_index{head.load(std::memory_order_relaxed)};
+        if (head_index == tail.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+
+        return &values[head_index];
+    }
+
+    // Consumer side, removes the value returned by front(), which must not be nullptr
+    void pop()
+    {
+        head.store((head.load(std::memory_order_relaxed) + 1) & (Capacity - 1), std::memory_order_release);
+    }
+
+private:
+    std::array<T, Capacity> values{};
+
+    // Each index is only written by one side, kept on separate cache lines so the threads don't contend
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+#endif  // SPSC_QUEUE_HPP
@@ -0,0 +1,115 @@
+#include "tone_generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "chip8_constants.hpp"
+
+namespace
+{
+const double TONE_FREQUENCY{440.0};
+const double TONE_VOLUME{0.3};
+// Length of the fade in and out applied at the edges of every beep
+const double RAMP_SECONDS{0.002};
+// Beeping ticks the output may fall behind by before the backlog is skipped, e.g. after the output stalled
+const std::uint64_t MAX_LAG_TICKS{2};
+
+template <typename T>
+void write_sample(char *data, const T value)
+{
+    std::memcpy(data, &value, sizeof(T));
+}
+}  // namespace
+
+ToneGenerator::ToneGenerator(const EmulatorThread &emulator, const QAudioFormat &format, QObject *parent) :
+    QIODevice(parent),
+    emulator(emulator),
+    format(format)
+{
+}
+
+qint64 ToneGenerator::bytesAvailable() const
+{
+    // Samples are made up on demand, so there is always another second of them
+    return format.bytesForDuration(1000000) + QIODevice::bytesAvailable();
+}
+
+qint64 ToneGenerator::readData(char *data, const qint64 max_size)
+{
+    const int frame_bytes{format.bytesPerFrame()};
+    if (frame_bytes <= 0)
+    {
+        return 0;
+    }
+
+    // While the sound timer is still running the tone keeps going even if it got ahead of the ticks counted so far,
+    // so jitter between the two threads can't cut a long beep into pieces. Read first, the tick count is final for
+    // every beep it says has ended
+    const bool running{emulator.sound_on()};
+
+    const std::uint64_t sample_rate{static_cast<std::uint64_t>(format.sampleRate())};
+    const std::uint64_t requested{emulator.sound_ticks() * sample_rate / TIMER_FREQUENCY};
+    const std::uint64_t max_lag{MAX_LAG_TICKS * sample_rate / TIMER_FREQUENCY};
+    if (requested > tone_samples + max_lag)
+    {
+        tone_samples = requested - max_lag;
+    }
+    else if (!running && tone_samples > requested)
+    {
+        // Samples played ahead of the last beep's ticks must not be taken from the next one
+        tone_samples = requested;
+    }
+
+    const double ramp_step{1.0 / (RAMP_SECONDS * static_cast<double>(sample_rate))};
+    const double phase_step{2.0 * M_PI * TONE_FREQUENCY / static_cast<double>(sample_rate)};
+
+    const qint64 frames{max_size / frame_bytes};
+    const int channels{format.channelCount()};
+    const int sample_bytes{format.bytesPerSample()};
+
+    for (qint64 frame{0}; frame < frames; frame++)
+    {
+        const bool gate{running || tone_samples < requested};
+        if (gate)
+        {
+            tone_samples++;
+        }
+
+        gain = gate ? std::min(1.0, gain + ramp_step) : std::max(0.0, gain - ramp_step);
+        phase = std::fmod(phase + phase_step, 2.0 * M_PI);
+
+        const double value{gain > 0.0 ? std::sin(phase) * gain * TONE_VOLUME : 0.0};
+
+        char *frame_data{data + frame * frame_bytes};
+        for (int channel{0}; channel < channels; channel++)
+        {
+            char *sample_data{frame_data + channel * sample_bytes};
+            switch (format.sampleFormat())
+            {
+                case QAudioFormat::UInt8:
+                    write_sample(sample_data, static_cast<quint8>(128 + std::lround(value * 127)));
+                    break;
+                case QAudioFormat::Int16:
+                    write_sample(sample_data, static_cast<qint16>(std::lround(value * 32767)));
+                    break;
+                case QAudioFormat::Int32:
+                    write_sample(sample_data, static_cast<qint32>(std::lround(value * 2147483647.0)));
+                    break;
+                case QAudioFormat::Float:
+                    write_sample(sample_data, static_cast<float>(value));
+                    break;
+                default:
+                    std::memset(sample_data, 0, sample_bytes);
+                    break;
+            }
+        }
+    }
+
+    return frames * frame_bytes;
+}
+
+qint64 ToneGenerator::writeData(const char *, const qint64)
+{
+    return -1;
+}
@@ -0,0 +1,42 @@
+#ifndef TONE_GENERATOR_HPP
+#define TONE_GENERATOR_HPP
+
+#include <QAudioFormat>
+#include <QIODevice>
+#include <cstdint>
+
+#include "emulator_thread.hpp"
+
+// Pull-mode audio source that synthesizes the beep on demand. Each timer tick the sound timer runs for becomes exactly
+// a 60th of a second of tone, so the beep follows the emulator with sample accuracy instead of being restarted per
+// beep. The output never stops, it plays silence while the sound timer is off
+class ToneGenerator : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    ToneGenerator(const EmulatorThread &emulator, const QAudioFormat &format, QObject *parent = nullptr);
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+
+    qint64 bytesAvailable() const override;
+
+protected:
+    qint64 readData(char *data, qint64 max_size) override;
+    qint64 writeData(const char *data, qint64 max_size) override;
+
+private:
+    const EmulatorThread &emulator;
+    QAudioFormat format;
+
+    // Samples of tone played so far, compared against the ones the emulator asked for
+    std::uint64_t tone_samples{0};
+    double phase{0.0};
+    // Envelope gain, ramped towards 0 or 1 so the tone never starts or stops with a click
+    double gain{0.0};
+};
+
+#endif  // TONE_GENERATOR_HPP
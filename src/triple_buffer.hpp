@@ -0,0 +1,63 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free handoff of the latest value from one writer thread to one reader thread. The writer fills back() and
+// publishes it, the reader picks up the newest published value with acquire() and reads it through front(). Neither
+// side ever waits, and the reader skips values published while it was busy
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Writer side, the buffer to fill before calling publish()
+    T &back()
+    {
+        return buffers[back_index];
+    }
+
+    // Writer side, makes back() the newest value and hands a free buffer back to the writer. Returns false if the
+    // previously published value was replaced before the reader picked it up
+    bool publish()
+    {
+        const std::uint8_t previous{middle.exchange(static_cast<std::uint8_t>(back_index | FRESH),
+                                                    std::memory_order_acq_rel)};
+        back_index = previous & INDEX_MASK;
+        return (previous & FRESH) == 0;
+    }
+
+    // Reader side, moves the newest published value to front(). Returns false if nothing was published since the
+    // previous call
+    bool acquire()
+    {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+        {
+            return false;
+        }
+
+        const std::uint8_t previous{middle.exchange(front_index, std::memory_order_acq_rel)};
+        front_index = previous & INDEX_MASK;
+        return true;
+    }
+
+    // Reader side, the value picked by the last acquire()
+    const T &front() const
+    {
+        return buffers[front_index];
+    }
+
+private:
+    static const std::uint8_t INDEX_MASK{0x3};
+    static const std::uint8_t FRESH{0x4};
+
+    std::array<T, 3> buffers{};
+
+    // Each index is only touched by one side, kept on separate cache lines so the threads don't contend
+    alignas(64) std::uint8_t back_index{0};
+    alignas(64) std::atomic<std::uint8_t> middle{1};
+    alignas(64) std::uint8_t front_index{2};
+};
+
+#endif  // TRIPLE_BUFFER_HPP
@@ -0,0 +1,108 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs task(index) for every index in [0, task_count) across thread_count threads and waits for all of them. Every
+// thread starts with a contiguous share of the indices, takes work from the back of its own queue and, once empty,
+// steals from the front of the others, so a few slow tasks don't leave the remaining threads idle. The first
+// exception thrown by a task is rethrown once every thread has stopped
+template <typename Task>
+void run_work_stealing(const std::size_t task_count, std::size_t thread_count, const Task &task)
+{
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> indices;
+    };
+
+    thread_count = std::max<std::size_t>(1, std::min(thread_count, task_count));
+
+    std::vector<WorkQueue> queues(thread_count);
+    for (std::size_t queue{0}; queue < thread_count; queue++)
+    {
+        const std::size_t first{task_count * queue / thread_count};
+        const std::size_t last{task_count * (queue + 1) / thread_count};
+        for (std::size_t index{first}; index < last; index++)
+        {
+            queues[queue].indices.push_back(index);
+        }
+    }
+
+    std::mutex error_mutex;
+    std::exception_ptr error{};
+
+    const auto take{[&queues, thread_count](const std::size_t worker, std::size_t &index)
+                    {
+                        {
+                            WorkQueue &own{queues[worker]};
+                            std::lock_guard<std::mutex> lock(own.mutex);
+                            if (!own.indices.empty())
+                            {
+                                index = own.indices.back();
+                                own.indices.pop_back();
+                                return true;
+                            }
+                        }
+
+                        for (std::size_t offset{1}; offset < thread_count; offset++)
+                        {
+                            WorkQueue &victim{queues[(worker + offset) % thread_count]};
+                            std::lock_guard<std::mutex> lock(victim.mutex);
+                            if (!victim.indices.empty())
+                            {
+                                index = victim.indices.front();
+                                victim.indices.pop_front();
+                                return true;
+                            }
+                        }
+
+                        // Tasks are never added once running, so every queue being empty means the work is done
+                        return false;
+                    }};
+
+    const auto work{[&](const std::size_t worker)
+                    {
+                        std::size_t index{};
+                        while (take(worker, index))
+                        {
+                            try
+                            {
+                                task(index);
+                            }
+                            catch (...)
+                            {
+                                std::lock_guard<std::mutex> lock(error_mutex);
+                                if (!error)
+                                {
+                                    error = std::current_exception();
+                                }
+                            }
+                        }
+                    }};
+
+    std::vector<std::thread> threads;
+    for (std::size_t worker{1}; worker < thread_count; worker++)
+    {
+        threads.emplace_back(work, worker);
+    }
+    work(0);
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif  // WORK_STEALING_POOL_HPP